@@ -0,0 +1,199 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+// Run the collector against a simulated multi-drop line on a pty, with
+// BUS_TEST_UNITS meter units. Each unit answers with a value starting
+// with its own address, and the last unit answers its first request
+// after the collector has given up on it, so the response arrives
+// during the exchange with another unit. Checks that every value shown
+// for a unit came from that unit, that all units were read, and that
+// the late response was counted as stray and not taken as the answer
+// to the exchange in flight. The simulator answers nothing while the
+// late unit delays, so other exchanges time out meanwhile. Exits
+// nonzero on failure.
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "optical_eye_utils.h"
+#include "pacing.h"
+
+#define BUS_TEST_UNITS 3
+#define BUS_TEST_SECONDS 9
+#define LATE_MILLISECONDS (PACING_INITIAL_TIMEOUT + 500)
+#define COLLECTOR_OUTPUT_LENGTH 65536
+
+static int master_fd;
+
+static void pause_milliseconds(int milliseconds)
+{
+    struct timespec pause = {milliseconds / 1000,
+                             milliseconds % 1000 * 1000000L};
+    nanosleep(&pause, NULL);
+}
+
+// Answer a read of `var_id` from the unit at `address`, with the value
+// `address`.nnn in the unit kW.
+static void respond(int address, int var_id, int count)
+{
+    unsigned char package[16], frame[32];
+    unsigned int value = address * 1000 + count % 1000;
+    int length = 0, crc;
+    package[length++] = 0x40;
+    package[length++] = address;
+    package[length++] = 0x10;
+    package[length++] = var_id >> 8;
+    package[length++] = var_id & 0xff;
+    package[length++] = 21;        // kW.
+    package[length++] = 4;
+    package[length++] = 0x43;      // 10^-3.
+    package[length++] = value >> 24;
+    package[length++] = value >> 16;
+    package[length++] = value >> 8;
+    package[length++] = value;
+    crc = crc16(package + 1, length - 1);
+    package[length++] = crc >> 8;
+    package[length++] = crc & 0xff;
+    package[length++] = '\r';
+    write(master_fd, frame, escape_package(package, length, frame));
+}
+
+// Read request frames from the line and answer those for the units.
+static void *simulate_line(void *unused)
+{
+    unsigned char frame[2 * REQUEST_BUFFER_LENGTH];
+    int length = 0, count = 0, late_pending = 1;
+    while (1) {
+        unsigned char c;
+        int address, var_id;
+        if (read(master_fd, &c, 1) != 1) return NULL;
+        if (c == 0x80) length = 0;
+        if (length < (int)sizeof(frame)) frame[length++] = c;
+        if (c != '\r' || frame[0] != 0x80) continue;
+        length = descape_package(frame, length);
+        if (length < 8 || frame[2] != 0x10) continue;
+        address = frame[1];
+        var_id = frame[4] << 8 | frame[5];
+        length = 0;
+        if (address < 1 || address > BUS_TEST_UNITS) continue;
+        if (address == BUS_TEST_UNITS && late_pending) {
+            late_pending = 0;
+            pause_milliseconds(LATE_MILLISECONDS);
+        }
+        respond(address, var_id, ++count);
+    }
+}
+
+// Run the collector on `line` for BUS_TEST_SECONDS, collecting stdout
+// and stderr in `output`.
+static void run_collector(char const *line, char *output, int capacity)
+{
+    char device[128];
+    int pipe_fds[2], length = 0, result;
+    pid_t pid;
+    snprintf(device, sizeof(device), "%s@1,2,3", line);
+    if (pipe(pipe_fds) < 0) fail("Could not create a pipe");
+    pid = fork();
+    if (pid < 0) fail("Could not fork");
+    if (pid == 0) {
+        dup2(pipe_fds[1], 1);
+        dup2(pipe_fds[1], 2);
+        close(pipe_fds[0]);
+        execl("./collector", "collector", "-S", "4", "-p", "1023:1",
+              device, (char *)NULL);
+        fail("Could not run ./collector");
+    }
+    close(pipe_fds[1]);
+    pause_milliseconds(BUS_TEST_SECONDS * 1000);
+    kill(pid, SIGINT);
+    while ((result = read(pipe_fds[0], output + length,
+                          capacity - 1 - length)) > 0) {
+        length += result;
+    }
+    output[length] = '\0';
+    waitpid(pid, NULL, 0);
+}
+
+int main(void)
+{
+    static char output[COLLECTOR_OUTPUT_LENGTH];
+    int values[BUS_TEST_UNITS + 1] = {0};
+    unsigned long exchanges = 0, timeouts = 0, stray = 0;
+    int failures = 0, address;
+    struct termios config;
+    pthread_t simulator;
+    char const *line;
+    char *next;
+
+    master_fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master_fd < 0 || grantpt(master_fd) < 0 || unlockpt(master_fd) < 0) {
+        fail("Could not open a pty");
+    }
+    line = ptsname(master_fd);
+    tcgetattr(master_fd, &config);
+    cfmakeraw(&config);
+    tcsetattr(master_fd, TCSANOW, &config);
+    if (pthread_create(&simulator, NULL, simulate_line, NULL)) {
+        fail("Could not start the simulator");
+    }
+    run_collector(line, output, sizeof(output));
+
+    for (next = output; *next; next = strchr(next, '\n') + 1) {
+        char *at = strstr(next, "@");
+        char *end = strchr(next, '\n');
+        char *none = strstr(next, "No response.");
+        double value;
+        if (!end) break;
+        if (sscanf(next, "collector: shard 0: %*d devices, %lu exchanges, "
+                   "%lu timeouts, %*d corrupted, %lu stray",
+                   &exchanges, &timeouts, &stray) == 3) {
+            continue;
+        }
+        // Exchanges time out while the simulator sleeps.
+        if (!at || at > end || !strstr(next, "(id 1023)") ||
+            (none && none < end)) {
+            continue;
+        }
+        address = atoi(at + 1);
+        if (address < 1 || address > BUS_TEST_UNITS ||
+            sscanf(strstr(next, "(id 1023): ") + 11, "%lf", &value) != 1) {
+            fprintf(stderr, "bus_test: unexpected line: %.*s\n",
+                    (int)(end - next), next);
+            failures++;
+            continue;
+        }
+        if ((int)value != address) {
+            fprintf(stderr, "bus_test: unit %d shows the value %.4f of "
+                    "unit %d\n", address, value, (int)value);
+            failures++;
+        }
+        values[address]++;
+    }
+
+    for (address = 1; address <= BUS_TEST_UNITS; address++) {
+        if (values[address] == 0) {
+            fprintf(stderr, "bus_test: no values from unit %d\n", address);
+            failures++;
+        }
+    }
+    if (timeouts < 1 || stray < 1) {
+        fprintf(stderr, "bus_test: expected a timeout and a stray response, "
+                "got %lu and %lu\n", timeouts, stray);
+        failures++;
+    }
+    if (failures) fputs(output, stderr);
+    printf("bus_test: %d units, %d %d %d values, %lu exchanges, "
+           "%lu timeouts, %lu stray, %d failures\n", BUS_TEST_UNITS,
+           values[1], values[2], values[3], exchanges, timeouts, stray,
+           failures);
+    return failures > 0;
+}
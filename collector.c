@@ -0,0 +1,1307 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "config.h"
+#include "deadband.h"
+#include "frames.h"
+#include "hotplug.h"
+#include "optical_eye_utils.h"
+#include "output.h"
+#include "rollup.h"
+#include "sampler.h"
+#include "session.h"
+#include "sink.h"
+#include "state.h"
+#include "store.h"
+#include "trace.h"
+#include "variables.h"
+#include "workpool.h"
+
+// The collector keeps one session per device, and polls variables on a
+// schedule, sweeps all known variables using the link time which is
+// left, and serves operator requests arriving on a FIFO with priority.
+// Devices which disappear, e.g., USB adapters being unplugged, are
+// reopened as soon as they are back, keeping their session state.
+//
+// Scheduled reads can be aggregated over windows of a given number of
+// seconds, per device and variable. When a window closes, a rollup
+// record is shown:
+//
+//   device: rollup id <var_id> window <seconds> start <epoch seconds>
+//     count <samples> min <value> max <value> mean <value> last <value>
+//     [unit]
+//
+// on one line. The samples themselves are then shown only if requested.
+//
+// Scheduled samples can also be shown only when they have changed by
+// more than a threshold, "<number>" or "<number>%" given after the
+// period, or when max_silence seconds have passed. Giving max_silence
+// applies this to all scheduled variables, with a zero threshold by
+// default.
+//
+// The devices can be sharded across threads, each running the event
+// loop for its own devices and pinned to its own cpu; the first shard
+// runs in the main thread and also serves the FIFO and the hot-plug
+// watch. Responses can be decoded by a pool of worker threads rather
+// than by the shards: each device has a mailbox of responses, and a
+// device with responses waiting is one task in the pool, so the
+// responses of a device are decoded in order, one at a time. With -S,
+// statistics per shard and worker are shown on stderr periodically, as
+// the basis for choosing the number of shards and workers.
+//
+// Output and stored records go through a ring to a sink thread, so a
+// stall on stdout or disk does not delay the exchanges. When the ring
+// is full, the policy given by -P decides: "block" waits for room,
+// "drop" drops the oldest records, and "rollup", the default, drops
+// samples once the ring is 3/4 full, keeping rollups, failures and
+// interactive responses. With -o, samples and rollups are appended to
+// a store, see store.h.
+//
+// Groups of registers can be sampled adaptively with -a: a group, named
+// as in frames.h or given as one register, is polled at a base period
+// while stable and at a fast period while its values change by more
+// than a threshold, or faster than a rate per second, see sampler.h.
+// The adaptive polls of a meter are kept within a budget given by -B,
+// in percent of the link time, by lengthening their periods.
+//
+// Several meter units sharing a multi-drop line are given as the device
+// followed by their addresses, e.g., /dev/ttyUSB0@1,2,3. Each unit is
+// then a device of its own, shown as "<device>@<address>", and the bus
+// of the line interleaves their exchanges, see session.h.
+//
+// With -k, a device which has been idle for the given number of seconds
+// is sent a keep-alive, see session.h, so scheduled reads find the link
+// warm.
+//
+// With -c, the RTC of each meter is read every given number of seconds,
+// and the session keeps an estimate of the meter clock, see session.h.
+// Stored records are stamped with the offset of the meter clock and the
+// bound on its error, so samples can be aligned with meter time, and
+// values shown are prefixed with the meter time, e.g., "[meter
+// 2015-06-01 12:00:00.250 +-0.600 s]", or "[meter time unknown]" until
+// the clock has been read. RTC values read on request are used as well,
+// and then stamp the values shown even without -c.
+//
+// With -T, the stages of the exchanges, decoding and output are traced,
+// see trace.h, and written to the given file at exit. The collector
+// exits on SIGINT and SIGTERM, after flushing its output.
+//
+// With -r, the session state of each device is kept in a state file,
+// see state.h, and restored at startup, so a restarted collector does
+// not have to rediscover the meters.
+
+#define DEFAULT_BAUDRATE B9600
+// The limits below size all memory used by the collector, which is
+// static; they can be set with -D, see PROFILE=small in the Makefile.
+// The pages of a device are only touched once it is given, so room for
+// several hundred optical heads costs address space, not memory.
+#ifndef MAX_DEVICES
+#define MAX_DEVICES 512
+#endif
+#ifndef MAX_SCHEDULED
+#define MAX_SCHEDULED 64
+#endif
+#ifndef MAX_WINDOWS
+#define MAX_WINDOWS 4
+#endif
+#ifndef DEVICE_PATH_LENGTH
+#define DEVICE_PATH_LENGTH PATH_MAX
+#endif
+#ifndef MAX_SHARDS
+#define MAX_SHARDS 16
+#endif
+#ifndef MAX_GROUPS
+#define MAX_GROUPS 8
+#endif
+#ifndef MAILBOX_LENGTH
+#define MAILBOX_LENGTH 4
+#endif
+#define COMMAND_LENGTH 256
+#define SHARD_COMMANDS 16
+
+typedef struct _scheduled_read {
+    int var_id;
+    int period;                    // Milliseconds.
+    int filtered;                  // Shown only when changed.
+    double absolute, relative;     // Deadband thresholds.
+    int group;                     // Adaptive group, or -1.
+} scheduled_read;
+
+// A response, as handed from the session to the decoding.
+typedef struct _response {
+    int var_id;
+    request_priority priority;
+    int length;
+    int intact;
+    int disconnected;              // The device was gone when refused.
+    struct timespec time;          // When the exchange ended.
+    int64_t meter_offset, meter_error; // See session.h.
+    unsigned char package[RESPONSE_BUFFER_LENGTH];
+} response;
+
+typedef struct _device_state {
+    session s;
+    char name[DEVICE_PATH_LENGTH]; // Path, with the address on a bus.
+    int shard;
+    uint32_t source;               // Of stored records.
+    // Of the meter clock at the last response, in milliseconds, for
+    // stored records.
+    int32_t meter_offset, meter_error;
+    state_device *saved;           // In the state file, or NULL.
+    char path[DEVICE_PATH_LENGTH]; // Stable path, used when reopening.
+    int baudrate;
+    int connected;
+    struct timespec last_attempt;  // To reopen the device.
+    struct timespec next_poll[MAX_SCHEDULED];
+    int sweep_index;               // Next entry of `var_data` to sweep.
+    rollup rollups[MAX_SCHEDULED][MAX_WINDOWS];
+    deadband deadbands[MAX_SCHEDULED];
+    sampler samplers[MAX_GROUPS];
+    // The previous value of each adaptive entry, if `previous_time` is set.
+    double previous[MAX_SCHEDULED];
+    struct timespec previous_time[MAX_SCHEDULED];
+    // Held while decoding, i.e., using the register cache, the rollups
+    // and the deadbands, which the shard also does to close rollups.
+    pthread_mutex_t decode_lock;
+    // Responses waiting for the pool, protected by `mailbox_lock`. When
+    // the mailbox is full, the oldest response is dropped.
+    pthread_mutex_t mailbox_lock;
+    response mailbox[MAILBOX_LENGTH];
+    int mailbox_first, mailbox_count;
+    int mailbox_queued;            // Set while a pool task is pending.
+    unsigned long decoded, dropped;
+} device_state;
+
+typedef struct _command {
+    int device_index;
+    int var_id;
+} command;
+
+typedef struct _shard {
+    int index;
+    pthread_t thread;
+    int wake_fds[2];               // A pipe waking the event loop.
+    // Requests from the FIFO and hot-plug events for the devices of
+    // the shard, protected by `lock`.
+    pthread_mutex_t lock;
+    command commands[SHARD_COMMANDS];
+    int command_first, command_count;
+    int reconnect;
+    // Statistics since they were last shown.
+    unsigned long busy_ns;         // Time spent outside of `poll`.
+    struct timespec since;
+} shard;
+
+static device_state devices[MAX_DEVICES];
+static int device_count = 0;
+static bus buses[MAX_DEVICES];     // Of the multi-drop lines.
+static int bus_count = 0;
+static scheduled_read schedule[MAX_SCHEDULED];
+static int schedule_count = 0;
+static int sweep = 0;
+static int windows[MAX_WINDOWS];   // Rollup window lengths, in seconds.
+static int window_count = 0;
+static int show_samples = 1;       // Show scheduled samples when rolled up.
+static int max_silence = 0;        // Seconds, 0: no limit.
+static sampler groups[MAX_GROUPS]; // Settings of the adaptive groups.
+static int group_count = 0;
+static int adaptive_count = 0;     // Scheduled entries in groups.
+static int link_budget = 50;       // Percent, for adaptive polls.
+static int keepalive = 0;          // Milliseconds, 0: no keep-alives.
+static int clock_interval = 0;     // Milliseconds, 0: no reads of the RTC.
+static volatile sig_atomic_t stopping = 0;
+static shard shards[MAX_SHARDS];
+static int shard_count = 1;
+static workpool pool;
+static int worker_count = 0;       // 0: decode in the shards.
+static int statistics_interval = 0; // Seconds, 0: none.
+static char *self;
+
+void usage(char *self) {
+    printf("Usage: %s [-b baudrate] [-p var_id[:seconds[:threshold]]]... "
+           "[-a group:base:fast[:threshold[:rate]]]... [-B percent] "
+           "[-m max_silence] [-k seconds] [-c seconds] [-s] "
+           "[-w seconds]... [-n] "
+           "[-f fifo] "
+           "[-t shards] [-j workers] [-S seconds] [-P block|drop|rollup] "
+           "[-o store] [-r state] [-T trace] [device[@address,...]...]\n",
+           self);
+    exit(0);
+}
+
+static void add_milliseconds(struct timespec *time, int milliseconds)
+{
+    time->tv_sec += milliseconds / 1000;
+    time->tv_nsec += (milliseconds % 1000) * 1000000L;
+    if (time->tv_nsec >= 1000000000L) {
+        time->tv_sec++;
+        time->tv_nsec -= 1000000000L;
+    }
+}
+
+static void wake_shard(shard *sh)
+{
+    char c = 0;
+    write(sh->wake_fds[1], &c, 1);
+}
+
+static void show_rollup(device_state *device, int var_id,
+                        rollup const *closed)
+{
+    char const *unit = register_unit(&device->s.registers, var_id);
+    output_format("%s: rollup id %i window %d start %ld count %d "
+                  "min %.10g max %.10g mean %.10g last %.10g [%s]\n",
+                  device->s.device, var_id, closed->window,
+                  (long)closed->start, closed->count, closed->min,
+                  closed->max, closed->sum / closed->count, closed->last,
+                  unit ? unit : "");
+}
+
+static void store_value(device_state *device, int var_id, store_kind kind,
+                        double value, struct timespec const *time,
+                        int window, int count, int sample)
+{
+    store_record record;
+    memset(&record, 0, sizeof(record));
+    record.time = time->tv_sec * 1000000000LL + time->tv_nsec;
+    record.value = value;
+    record.source = device->source;
+    record.window = window;
+    record.count = count;
+    record.meter_offset = device->meter_offset;
+    record.meter_error = device->meter_error;
+    record.var_id = var_id;
+    record.kind = kind;
+    record.unit = register_unit_code(&device->s.registers, var_id);
+    sink_store(&record, sample);
+}
+
+static void store_rollup(device_state *device, int var_id,
+                         rollup const *closed)
+{
+    struct timespec start = {closed->start, 0};
+    store_value(device, var_id, STORE_MIN, closed->min, &start,
+                closed->window, closed->count, RING_ESSENTIAL);
+    store_value(device, var_id, STORE_MAX, closed->max, &start,
+                closed->window, closed->count, RING_ESSENTIAL);
+    store_value(device, var_id, STORE_MEAN, closed->sum / closed->count,
+                &start, closed->window, closed->count, RING_ESSENTIAL);
+    store_value(device, var_id, STORE_LAST, closed->last, &start,
+                closed->window, closed->count, RING_ESSENTIAL);
+}
+
+// Show the rollups of `device` whose windows have ended at `now`, and
+// return the number of milliseconds until the next one ends, or -1.
+static int close_rollups(device_state *device, time_t now)
+{
+    int entry, window, wakeup = -1;
+    for (entry = 0; entry < schedule_count; entry++) {
+        for (window = 0; window < window_count; window++) {
+            rollup *r = &device->rollups[entry][window], closed;
+            int remaining;
+            if (rollup_close(r, now, &closed)) {
+                show_rollup(device, schedule[entry].var_id, &closed);
+                output_flush();
+                if (sink_storing()) {
+                    store_rollup(device, schedule[entry].var_id, &closed);
+                }
+            }
+            remaining = rollup_remaining(r, now);
+            if (remaining >= 0 && (wakeup < 0 || remaining * 1000 < wakeup)) {
+                wakeup = remaining * 1000;
+            }
+        }
+    }
+    return wakeup;
+}
+
+static int scheduled_entry(int var_id)
+{
+    int entry;
+    for (entry = 0; entry < schedule_count; entry++) {
+        if (schedule[entry].var_id == var_id) break;
+    }
+    return entry;
+}
+
+// Add the value in `package`, received at `now`, to the rollups of
+// `var_id`. Returns zero if the package has no value to aggregate.
+static int add_sample(device_state *device, int var_id,
+                      unsigned char const *package, int length, time_t now)
+{
+    int entry = scheduled_entry(var_id), window;
+    double value;
+    if (entry == schedule_count ||
+        !package_value(&device->s.registers, package, length, var_id,
+                       &value)) {
+        return 0;
+    }
+    close_rollups(device, now);
+    for (window = 0; window < window_count; window++) {
+        rollup_add(&device->rollups[entry][window], now, value);
+    }
+    return 1;
+}
+
+// Return 1 if the scheduled sample in `package` should be shown.
+static int sample_changed(device_state *device, int var_id,
+                          unsigned char const *package, int length,
+                          time_t now)
+{
+    int entry = scheduled_entry(var_id);
+    if (entry == schedule_count || !schedule[entry].filtered) return 1;
+    return deadband_package(device->deadbands + entry, &device->s.registers,
+                            now, package, length, var_id);
+}
+
+// The period of the scheduled entry `index` on `device`: that of its
+// group if it is adaptive, but no shorter than what keeps the adaptive
+// polls within the link budget.
+static int entry_period(device_state *device, int index)
+{
+    int period, minimum;
+    if (schedule[index].group < 0) return schedule[index].period;
+    period = device->samplers[schedule[index].group].period;
+    minimum = pacing_exchange_time(&device->s.pacing) * adaptive_count *
+        100 / link_budget;
+    return period > minimum ? period : minimum;
+}
+
+static int earlier(struct timespec const *a, struct timespec const *b)
+{
+    return a->tv_sec < b->tv_sec ||
+        (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
+
+// Adjust the period of the adaptive group of the scheduled sample `r`,
+// moving the next polls of the group closer when it was shortened.
+static void adapt(device_state *device, response const *r)
+{
+    int entry = scheduled_entry(r->var_id), group, index;
+    double value;
+    if (entry == schedule_count || schedule[entry].group < 0 ||
+        !package_value(&device->s.registers, r->package, r->length,
+                       r->var_id, &value)) {
+        return;
+    }
+    group = schedule[entry].group;
+    if (device->previous_time[entry].tv_sec &&
+        sampler_update(device->samplers + group, device->previous[entry],
+                       device->previous_time + entry, value, &r->time)) {
+        for (index = 0; index < schedule_count; index++) {
+            struct timespec due;
+            if (schedule[index].group != group) continue;
+            clock_gettime(CLOCK_MONOTONIC, &due);
+            // The link budget is applied from the poll after this one,
+            // as the pacing belongs to the shard.
+            add_milliseconds(&due, device->samplers[group].period);
+            if (earlier(&due, device->next_poll + index)) {
+                device->next_poll[index] = due;
+            }
+        }
+        if (worker_count > 0) wake_shard(shards + device->shard);
+    }
+    device->previous[entry] = value;
+    device->previous_time[entry] = r->time;
+}
+
+// Responses to scheduled and sweep requests are samples, which the
+// ring may drop; the rest, including failures, are essential.
+static void show_response(device_state *device, response *r)
+{
+    session *s = &device->s;
+    int sample = r->priority != PRIORITY_INTERACTIVE && r->length > 0 &&
+        r->intact;
+    double value;
+    if (r->length > 0) {
+        device->meter_offset = r->meter_offset / 1000000;
+        device->meter_error = r->meter_error < 0 ? -1 :
+            (r->meter_error + 999999) / 1000000;
+    }
+    if (r->length > 0 && r->intact && sink_storing() &&
+        package_value(&s->registers, r->package, r->length, r->var_id,
+                      &value)) {
+        store_value(device, r->var_id, STORE_SAMPLE, value, &r->time, 0, 1,
+                    sample);
+    }
+    if (r->priority == PRIORITY_SCHEDULED && sample) {
+        if (group_count > 0) adapt(device, r);
+        if (window_count > 0 &&
+            add_sample(device, r->var_id, r->package, r->length,
+                       r->time.tv_sec) &&
+            !show_samples) {
+            return;
+        }
+        if (!sample_changed(device, r->var_id, r->package, r->length,
+                            r->time.tv_sec)) {
+            return;
+        }
+    }
+    if (r->length > 0 && (clock_interval > 0 || r->meter_error >= 0)) {
+        char meter[64];
+        meter_clock_format(meter, sizeof(meter),
+                           r->time.tv_sec * 1000000000LL + r->time.tv_nsec,
+                           r->meter_offset, r->meter_error);
+        output_format("%s: [%s] ", s->device, meter);
+    } else {
+        output_format("%s: ", s->device);
+    }
+    output_format("%s (id %i): ", var_name_of_id(r->var_id), r->var_id);
+    if (r->length < 0 && r->disconnected) {
+        output_string("Device disconnected, request refused.\n");
+    } else if (r->length < 0) {
+        output_string("Meter not responding, request refused.\n");
+    } else if (r->length == 0) {
+        output_string("No response.\n");
+    } else {
+        show_package(&s->registers, r->package, r->length, r->var_id);
+    }
+    if (sample) {
+        output_flush_sample();
+    } else {
+        output_flush();
+    }
+}
+
+static void decode_response(device_state *device, response *r)
+{
+    int64_t start = TRACE_NOW();
+    pthread_mutex_lock(&device->decode_lock);
+    show_response(device, r);
+    if (device->saved && r->length > 0 && r->intact) {
+        state_save_register(device->saved, &device->s.registers, r->var_id);
+    }
+    device->decoded++;
+    pthread_mutex_unlock(&device->decode_lock);
+    TRACE_SPAN("decode", TRACE_THREAD_TRACK, device->name, r->var_id, start);
+}
+
+// The pool task of a device: decode the responses in its mailbox.
+static void drain_mailbox(void *task)
+{
+    device_state *device = task;
+    response r;
+    pthread_mutex_lock(&device->mailbox_lock);
+    while (device->mailbox_count > 0) {
+        r = device->mailbox[device->mailbox_first];
+        device->mailbox_first = (device->mailbox_first + 1) % MAILBOX_LENGTH;
+        device->mailbox_count--;
+        pthread_mutex_unlock(&device->mailbox_lock);
+        decode_response(device, &r);
+        pthread_mutex_lock(&device->mailbox_lock);
+    }
+    device->mailbox_queued = 0;
+    pthread_mutex_unlock(&device->mailbox_lock);
+}
+
+static void fill_response(response *r, session *s, int var_id,
+                          request_priority priority,
+                          unsigned char const *package, int length,
+                          int intact)
+{
+    r->var_id = var_id;
+    r->priority = priority;
+    r->length = length;
+    r->intact = intact;
+    r->disconnected = s->fd < 0;
+    clock_gettime(CLOCK_REALTIME, &r->time);
+    r->meter_offset = s->meter_offset;
+    r->meter_error = s->meter_error;
+    if (length > 0) memcpy(r->package, package, length);
+}
+
+// The response handler of the sessions, running in the shard.
+void receive_response(session *s, int var_id, request_priority priority,
+                      unsigned char *package, int length, int intact)
+{
+    device_state *device = s->context;
+    int submit;
+    if (device->saved) {
+        state_save_pacing(device->saved, s);
+        if (length > 0 && intact) device->saved->baudrate = device->baudrate;
+    }
+    if (worker_count == 0) {
+        response r;
+        fill_response(&r, s, var_id, priority, package, length, intact);
+        decode_response(device, &r);
+        return;
+    }
+    pthread_mutex_lock(&device->mailbox_lock);
+    if (device->mailbox_count == MAILBOX_LENGTH) {
+        device->mailbox_first = (device->mailbox_first + 1) % MAILBOX_LENGTH;
+        device->mailbox_count--;
+        device->dropped++;
+    }
+    fill_response(device->mailbox + (device->mailbox_first +
+                                     device->mailbox_count) % MAILBOX_LENGTH,
+                  s, var_id, priority, package, length, intact);
+    device->mailbox_count++;
+    submit = !device->mailbox_queued;
+    device->mailbox_queued = 1;
+    pthread_mutex_unlock(&device->mailbox_lock);
+    // At most one task per device is pending, so the deque only fills
+    // up if it is shorter than the number of devices.
+    if (submit && !workpool_submit(&pool, device->shard, device)) {
+        drain_mailbox(device);
+    }
+}
+
+// Continue where the previous run left off, if `device` is in the
+// state file.
+static void restore_device(device_state *device)
+{
+    int registers, index;
+    if (!device->saved) return;
+    registers = state_restore(device->saved, &device->s);
+    for (index = 0;
+         index < device->saved->sweep_index && var_data[index].description;
+         index++) {
+    }
+    device->sweep_index = index;
+    if (registers > 0 || device->s.pacing.sample_count > 0) {
+        fprintf(stderr, "%s: %s: restored %d registers, %d turnaround "
+                "times\n", self, device->s.device, registers,
+                device->s.pacing.sample_count);
+    }
+}
+
+// Queue the scheduled reads which are due, and return the number of
+// milliseconds until the next one is due.
+static int queue_scheduled(device_state *device)
+{
+    int index, wakeup = -1;
+    for (index = 0; index < schedule_count; index++) {
+        int due_in = -milliseconds_since(device->next_poll + index);
+        if (due_in <= 0) {
+            int period = entry_period(device, index);
+            if (!session_contains(&device->s, schedule[index].var_id,
+                                  PRIORITY_SCHEDULED)) {
+                session_submit(&device->s, schedule[index].var_id,
+                               PRIORITY_SCHEDULED);
+            }
+            add_milliseconds(device->next_poll + index, period);
+            due_in = -milliseconds_since(device->next_poll + index);
+            if (due_in < 0) {
+                // Far behind schedule: restart the period from now.
+                clock_gettime(CLOCK_MONOTONIC, device->next_poll + index);
+                add_milliseconds(device->next_poll + index, period);
+                due_in = period;
+            }
+        }
+        if (wakeup < 0 || due_in < wakeup) wakeup = due_in;
+    }
+    return wakeup;
+}
+
+// Keep one sweep request queued whenever the link has nothing else to do.
+static void queue_sweep(device_state *device)
+{
+    if (!sweep || !session_idle(&device->s) || device->s.fd < 0 ||
+        device->s.health.state == CIRCUIT_OPEN) {
+        return;
+    }
+    if (!var_data[device->sweep_index].description) device->sweep_index = 0;
+    session_submit(&device->s, var_data[device->sweep_index].id,
+                   PRIORITY_BULK);
+    device->sweep_index++;
+    if (device->saved) device->saved->sweep_index = device->sweep_index;
+}
+
+// Submit an interactive request to a device of the calling shard.
+static void submit_interactive(device_state *device, int var_id)
+{
+    if (!session_submit(&device->s, var_id, PRIORITY_INTERACTIVE)) {
+        fprintf(stderr, "%s: Too many requests for %s\n", self,
+                device->s.device);
+    }
+}
+
+// Handle a command line from the FIFO: "[device] var_id_or_name". The
+// request goes to the first device when no device is given, and is
+// passed on to the shard of the device.
+static void handle_command(shard *sh, char *line)
+{
+    char *var_arg = line + strspn(line, " \t");
+    char *end = var_arg + strlen(var_arg);
+    int index, var_id, device_index = 0;
+    while (end > var_arg && strchr(" \t\r", end[-1])) *--end = '\0';
+    if (!*var_arg) return;
+    for (index = 0; index < device_count; index++) {
+        int length = strlen(devices[index].s.device);
+        if (!strncmp(var_arg, devices[index].s.device, length) &&
+            (var_arg[length] == ' ' || var_arg[length] == '\t')) {
+            device_index = index;
+            var_arg += length + strspn(var_arg + length, " \t");
+            break;
+        }
+    }
+    var_id = atoi(var_arg);
+    if (var_id == 0) var_id = var_id_of_partial_name(var_arg);
+    if (var_id == 0) {
+        fprintf(stderr, "%s: Unknown variable '%s'\n", self, var_arg);
+    } else if (devices[device_index].shard == sh->index) {
+        submit_interactive(devices + device_index, var_id);
+    } else {
+        shard *target = shards + devices[device_index].shard;
+        pthread_mutex_lock(&target->lock);
+        if (target->command_count == SHARD_COMMANDS) {
+            fprintf(stderr, "%s: Too many requests for %s\n", self,
+                    devices[device_index].s.device);
+        } else {
+            command *c = target->commands +
+                (target->command_first + target->command_count) %
+                SHARD_COMMANDS;
+            c->device_index = device_index;
+            c->var_id = var_id;
+            target->command_count++;
+        }
+        pthread_mutex_unlock(&target->lock);
+        wake_shard(target);
+    }
+}
+
+// Take the requests and hot-plug events passed on to the shard. Returns
+// nonzero if the devices should be reopened at once.
+static int take_commands(shard *sh)
+{
+    int reconnect;
+    char drained[64];
+    while (read(sh->wake_fds[0], drained, sizeof(drained)) > 0);
+    pthread_mutex_lock(&sh->lock);
+    while (sh->command_count > 0) {
+        command *c = sh->commands + sh->command_first;
+        submit_interactive(devices + c->device_index, c->var_id);
+        sh->command_first = (sh->command_first + 1) % SHARD_COMMANDS;
+        sh->command_count--;
+    }
+    reconnect = sh->reconnect;
+    sh->reconnect = 0;
+    pthread_mutex_unlock(&sh->lock);
+    return reconnect;
+}
+
+// Try to reopen the disconnected devices of the shard, all of them if
+// `now`, and otherwise those not tried for HOTPLUG_RETRY_INTERVAL.
+// Returns the number of milliseconds until the next attempt is due, or
+// -1.
+static int reconnect_devices(shard *sh, int now)
+{
+    int index, wakeup = -1;
+    for (index = 0; index < device_count; index++) {
+        device_state *device = devices + index;
+        int due_in, fd;
+        // The units on a bus are attached together.
+        if (device->shard != sh->index || device->s.fd >= 0) continue;
+        if (device->connected) {
+            fprintf(stderr, "%s: %s disconnected\n", self, device->s.device);
+            device->connected = 0;
+            now = 1;
+        }
+        due_in = HOTPLUG_RETRY_INTERVAL -
+            milliseconds_since(&device->last_attempt);
+        if (now || due_in <= 0) {
+            clock_gettime(CLOCK_MONOTONIC, &device->last_attempt);
+            fd = reopen_optical_eye(device->path, device->baudrate, IS_8N2);
+            if (fd >= 0) {
+                if (LOW_LATENCY) {
+                    optical_eye_low_latency(self, fd, device->path);
+                }
+                session_attach(&device->s, fd);
+                device->connected = 1;
+                fprintf(stderr, "%s: %s reconnected\n", self,
+                        device->s.device);
+                continue;
+            }
+            due_in = HOTPLUG_RETRY_INTERVAL;
+        }
+        if (wakeup < 0 || due_in < wakeup) wakeup = due_in;
+    }
+    return wakeup;
+}
+
+// Pass a hot-plug event on to all shards.
+static void hotplug_event(shard *sh)
+{
+    int index;
+    for (index = 0; index < shard_count; index++) {
+        if (index == sh->index) continue;
+        pthread_mutex_lock(&shards[index].lock);
+        shards[index].reconnect = 1;
+        pthread_mutex_unlock(&shards[index].lock);
+        wake_shard(shards + index);
+    }
+    reconnect_devices(sh, 1);
+}
+
+static long nanoseconds_between(struct timespec const *start,
+                                struct timespec const *end)
+{
+    return (end->tv_sec - start->tv_sec) * 1000000000L +
+        end->tv_nsec - start->tv_nsec;
+}
+
+// Show the statistics of every shard and worker on stderr, and start
+// over. Counters are read without locking, they are only indications.
+static void show_statistics(void)
+{
+    sink_statistics ring_statistics;
+    int index, device;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    for (index = 0; index < shard_count; index++) {
+        shard *sh = shards + index;
+        unsigned long exchanges = 0, timeouts = 0, corrupted = 0;
+        unsigned long decoded = 0, dropped = 0, stray = 0;
+        int devices_in_shard = 0;
+        long elapsed = nanoseconds_between(&sh->since, &now);
+        for (device = 0; device < device_count; device++) {
+            device_state *d = devices + device;
+            if (d->shard != index) continue;
+            devices_in_shard++;
+            exchanges += d->s.health.exchanges;
+            timeouts += d->s.health.timeouts;
+            corrupted += d->s.health.corrupted;
+            decoded += d->decoded;
+            dropped += d->dropped;
+            // Counted once per bus, by its first unit.
+            if (d->s.bus && d->s.bus->units[0] == &d->s) {
+                stray += d->s.bus->stray;
+            }
+        }
+        fprintf(stderr, "%s: shard %d: %d devices, %lu exchanges, "
+                "%lu timeouts, %lu corrupted, %lu stray, %lu decoded, "
+                "%lu dropped, %.1f%% busy\n", self, index, devices_in_shard,
+                exchanges, timeouts, corrupted, stray, decoded, dropped,
+                elapsed > 0 ? 100.0 * sh->busy_ns / elapsed : 0.0);
+        sh->busy_ns = 0;
+        sh->since = now;
+    }
+    for (index = 0; index < worker_count; index++) {
+        fprintf(stderr, "%s: worker %d: %lu tasks, %lu stolen\n", self,
+                index, pool.deques[index].executed,
+                pool.deques[index].stolen);
+    }
+    for (device = 0; device < device_count; device++) {
+        session const *s = &devices[device].s;
+        if (keepalive > 0) {
+            fprintf(stderr, "%s: %s: %lu keep-alives, %lu failed, last %d ms\n",
+                    self, devices[device].name, s->keepalives,
+                    s->keepalive_failures, s->keepalive_turnaround);
+        }
+        if (clock_interval > 0) {
+            int64_t offset, error;
+            struct timespec local;
+            clock_gettime(CLOCK_REALTIME, &local);
+            if (meter_clock_estimate(&s->clock, local.tv_sec * 1000000000LL +
+                                     local.tv_nsec, &offset, &error)) {
+                fprintf(stderr, "%s: %s: clock offset %.3f s, error %.3f s, "
+                        "drift %.1f ppm, %lu reads, %lu steps\n", self,
+                        devices[device].name, offset / 1e9, error / 1e9,
+                        s->clock.drift * 1e6, s->clock.reads,
+                        s->clock.steps);
+            }
+        }
+        for (index = 0; index < group_count; index++) {
+            sampler const *s = devices[device].samplers + index;
+            fprintf(stderr, "%s: %s: group %d: period %d ms, %lu triggers\n",
+                    self, devices[device].name, index, s->period,
+                    s->triggers);
+        }
+    }
+    sink_get_statistics(&ring_statistics);
+    fprintf(stderr, "%s: ring: depth %d, max %d of %d, %lu records, "
+            "%lu dropped, %lu samples dropped, %lu waits\n", self,
+            ring_statistics.depth, ring_statistics.max_depth,
+            ring_statistics.capacity, ring_statistics.pushed,
+            ring_statistics.dropped, ring_statistics.dropped_samples,
+            ring_statistics.waits);
+}
+
+static int open_fifo(char const *path)
+{
+    int fd;
+    if (mkfifo(path, 0620) < 0 && errno != EEXIST) {
+        fail("Could not create the command FIFO");
+    }
+    fd = open(path, O_RDONLY | O_NONBLOCK);
+    if (fd < 0) fail("Could not open the command FIFO");
+    // Keep a writer open, such that the FIFO does not report EOF each
+    // time a client has written a command.
+    if (open(path, O_WRONLY) < 0) fail("Could not open the command FIFO");
+    return fd;
+}
+
+static void read_commands(shard *sh, int fifo_fd)
+{
+    static char pending[COMMAND_LENGTH];
+    static int pending_length = 0;
+    int received = read(fifo_fd, pending + pending_length,
+                        COMMAND_LENGTH - 1 - pending_length);
+    char *line, *newline;
+    if (received <= 0) return;
+    pending_length += received;
+    pending[pending_length] = '\0';
+    line = pending;
+    while ((newline = strchr(line, '\n'))) {
+        *newline = '\0';
+        handle_command(sh, line);
+        line = newline + 1;
+    }
+    pending_length -= line - pending;
+    memmove(pending, line, pending_length);
+    if (pending_length == COMMAND_LENGTH - 1) pending_length = 0;
+}
+
+// The event loop of a shard. The FIFO and the hot-plug watch are
+// served by the first shard, and are -1 for the others.
+// Stop the shards other than the first, which is running this, and then
+// the decoding workers, which the shards feed.
+static void stop_threads(void)
+{
+    int index;
+    for (index = 1; index < shard_count; index++) {
+        wake_shard(shards + index);
+        pthread_join(shards[index].thread, NULL);
+    }
+    if (worker_count > 0) workpool_stop(&pool);
+}
+
+static void run_shard(shard *sh, int fifo_fd, int watch_fd)
+{
+    struct timespec statistics_due;
+    clock_gettime(CLOCK_MONOTONIC, &statistics_due);
+    add_milliseconds(&statistics_due, statistics_interval * 1000);
+    clock_gettime(CLOCK_MONOTONIC, &sh->since);
+    while (1) {
+        struct pollfd fds[MAX_DEVICES + 3];
+        struct timespec busy_start, busy_end;
+        int fd_count = 0, fifo_index = -1, watch_index = -1, index, timeout;
+        time_t now = time(NULL);
+        clock_gettime(CLOCK_MONOTONIC, &busy_start);
+        timeout = reconnect_devices(sh, 0);
+        for (index = 0; index < device_count; index++) {
+            device_state *device = devices + index;
+            int wakeup, scheduled;
+            if (device->shard != sh->index) continue;
+            // The adaptive sampling moves the polls while decoding.
+            pthread_mutex_lock(&device->decode_lock);
+            wakeup = close_rollups(device, now);
+            scheduled = queue_scheduled(device);
+            pthread_mutex_unlock(&device->decode_lock);
+            if (timeout < 0 || (wakeup >= 0 && wakeup < timeout)) {
+                timeout = wakeup;
+            }
+            wakeup = scheduled;
+            session_service(&device->s);
+            // Sweep once the exchanges above have been started or ended.
+            queue_sweep(device);
+            session_service(&device->s);
+            if (timeout < 0 || (wakeup >= 0 && wakeup < timeout)) {
+                timeout = wakeup;
+            }
+            wakeup = session_wakeup(&device->s);
+            if (timeout < 0 || (wakeup >= 0 && wakeup < timeout)) {
+                timeout = wakeup;
+            }
+            if (device->s.busy) {
+                fds[fd_count].fd = device->s.fd;
+                fds[fd_count].events = POLLIN;
+                fd_count++;
+            }
+        }
+        if (statistics_interval > 0 && sh->index == 0) {
+            int due_in = -milliseconds_since(&statistics_due);
+            if (due_in <= 0) {
+                show_statistics();
+                add_milliseconds(&statistics_due, statistics_interval * 1000);
+                due_in = -milliseconds_since(&statistics_due);
+                if (due_in < 0) due_in = 0;
+            }
+            if (timeout < 0 || due_in < timeout) timeout = due_in;
+        }
+        fds[fd_count].fd = sh->wake_fds[0];
+        fds[fd_count].events = POLLIN;
+        fd_count++;
+        if (fifo_fd >= 0) {
+            fds[fd_count].fd = fifo_fd;
+            fds[fd_count].events = POLLIN;
+            fifo_index = fd_count++;
+        }
+        if (watch_fd >= 0) {
+            fds[fd_count].fd = watch_fd;
+            fds[fd_count].events = POLLIN;
+            watch_index = fd_count++;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &busy_end);
+        sh->busy_ns += nanoseconds_between(&busy_start, &busy_end);
+        poll(fds, fd_count, timeout);
+        // Only the main thread, running the first shard, takes signals,
+        // and the handler also wakes it through its pipe, so a signal
+        // arriving before poll is not slept through. It stops the other
+        // shards and the workers before exiting, so their last output
+        // is in the ring when the sink drains it.
+        if (stopping) {
+            if (sh->index > 0) return;
+            stop_threads();
+            exit(0);
+        }
+        if (take_commands(sh)) reconnect_devices(sh, 1);
+        if (fifo_index >= 0 && (fds[fifo_index].revents & POLLIN)) {
+            read_commands(sh, fifo_fd);
+        }
+        if (watch_index >= 0 && (fds[watch_index].revents & POLLIN) &&
+            hotplug_changed(watch_fd)) {
+            hotplug_event(sh);
+        }
+    }
+}
+
+// Add the adaptive group "group:base:fast[:threshold[:rate]]", with the
+// periods in seconds, scheduling each of its registers.
+static void add_group(char *arg)
+{
+    char *fields[6];
+    int count = 0, base, fast, index;
+    double absolute = 0, relative = 0, rate = 0;
+    unsigned short var_ids[BATCH_MAX_REGISTERS];
+    int var_id_count = 1;
+    batch_frame const *batch;
+    for (fields[0] = strtok(arg, ":"); fields[count] && count < 5;
+         fields[++count] = strtok(NULL, ":")) {
+    }
+    if (count < 3 || group_count == MAX_GROUPS) usage(self);
+    base = (int)(atof(fields[1]) * 1000);
+    fast = (int)(atof(fields[2]) * 1000);
+    if (count > 3 && !deadband_threshold(fields[3], &absolute, &relative)) {
+        usage(self);
+    }
+    if (count > 4) rate = atof(fields[4]);
+    if (base <= 0 || fast <= 0 || (absolute <= 0 && relative <= 0 &&
+                                   rate <= 0)) {
+        usage(self);
+    }
+    if ((batch = batch_frame_of(fields[0]))) {
+        var_id_count = batch->count;
+        memcpy(var_ids, batch->var_ids, batch->count * sizeof(*var_ids));
+    } else {
+        var_ids[0] = atoi(fields[0]);
+        if (var_ids[0] == 0) var_ids[0] = var_id_of_partial_name(fields[0]);
+        if (var_ids[0] == 0) usage(self);
+    }
+    if (schedule_count + var_id_count > MAX_SCHEDULED) usage(self);
+    sampler_init(groups + group_count, base, fast, absolute, relative, rate);
+    for (index = 0; index < var_id_count; index++) {
+        scheduled_read *entry = schedule + schedule_count++;
+        memset(entry, 0, sizeof(*entry));
+        entry->var_id = var_ids[index];
+        entry->period = base;
+        entry->group = group_count;
+        adaptive_count++;
+    }
+    group_count++;
+}
+
+// Take the addresses following "@" in the device argument `device`,
+// which is cut there, into `addresses`. Returns their number, and 0 if
+// there are none, i.e., the device is not a multi-drop line.
+static int parse_addresses(char *device, int *addresses)
+{
+    char *list = strchr(device, '@'), *next, *end;
+    int count = 0;
+    if (!list) return 0;
+    *list++ = '\0';
+    for (next = strtok(list, ","); next; next = strtok(NULL, ",")) {
+        long address = strtol(next, &end, 0);
+        if (*end || address < 0 || address > 0xff ||
+            count == BUS_MAX_UNITS) {
+            usage(self);
+        }
+        addresses[count++] = (int)address;
+    }
+    if (count == 0) usage(self);
+    return count;
+}
+
+// Set up the unit at `address` on the line `path`, open as `fd`; on
+// `line` if it is a multi-drop line, else NULL.
+static void add_device(char const *path, int fd, int address, bus *line,
+                       int line_index, state_file *state)
+{
+    device_state *device = devices + device_count;
+    if (device_count == MAX_DEVICES) usage(self);
+    if (line) {
+        snprintf(device->name, DEVICE_PATH_LENGTH, "%s@%d", path, address);
+    } else {
+        snprintf(device->name, DEVICE_PATH_LENGTH, "%s", path);
+    }
+    session_init(&device->s, fd, device->name, receive_response, device);
+    session_set_address(&device->s, address);
+    device->s.keepalive = keepalive;
+    device->s.clock_interval = clock_interval;
+    device->meter_error = -1;
+    if (line && !bus_join(line, &device->s)) usage(self);
+    device->shard = line_index % shard_count;
+    device->source = store_source(device->name);
+    memcpy(device->samplers, groups, sizeof(groups));
+    device->saved = state ? state_device_of(state, device->name) : NULL;
+    restore_device(device);
+    pthread_mutex_init(&device->decode_lock, NULL);
+    pthread_mutex_init(&device->mailbox_lock, NULL);
+    stable_device_path(path, device->path, DEVICE_PATH_LENGTH);
+    device->baudrate = optical_eye_baudrate(fd);
+    device->connected = 1;
+    device_count++;
+}
+
+static void stop(int signal)
+{
+    int saved_errno = errno;
+    stopping = 1;
+    wake_shard(shards);
+    errno = saved_errno;
+}
+
+static void *shard_thread(void *argument)
+{
+    shard *sh = argument;
+    pin_to_cpu(sh->index);
+    run_shard(sh, -1, -1);
+    // Only the buffer of the main thread is flushed at exit.
+    output_flush();
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    int baudrate = DEFAULT_BAUDRATE;
+    char const *fifo = NULL, *store_path = NULL, *state_path = NULL;
+    char const *trace_path = NULL;
+    sigset_t signals;
+    state_file *state = NULL;
+    ring_policy policy = RING_ROLLUP_ONLY;
+    int store_fd = -1;
+    int fifo_fd = -1, watch_fd, option, index, line_count = 0;
+
+    self = argv[0];
+    while ((option = getopt(argc, argv, "b:p:a:B:m:k:c:sw:nf:t:j:S:P:o:r:T:")) != -1) {
+        switch (option) {
+            case 'b':
+                baudrate = baudrate_of(argv[0], optarg);
+                break;
+            case 'p': {
+                char *period = strchr(optarg, ':');
+                char *threshold = period ? strchr(period + 1, ':') : NULL;
+                if (schedule_count == MAX_SCHEDULED) usage(argv[0]);
+                if (threshold) {
+                    *threshold++ = '\0';
+                    if (!deadband_threshold(
+                            threshold, &schedule[schedule_count].absolute,
+                            &schedule[schedule_count].relative)) {
+                        usage(argv[0]);
+                    }
+                    schedule[schedule_count].filtered = 1;
+                }
+                schedule[schedule_count].var_id = atoi(optarg);
+                if (schedule[schedule_count].var_id == 0) {
+                    if (period) *period = '\0';
+                    schedule[schedule_count].var_id =
+                        var_id_of_partial_name(optarg);
+                }
+                schedule[schedule_count].period =
+                    period ? (int)(atof(period + 1) * 1000) : 1000;
+                schedule[schedule_count].group = -1;
+                if (schedule[schedule_count].var_id == 0 ||
+                    schedule[schedule_count].period <= 0) {
+                    usage(argv[0]);
+                }
+                schedule_count++;
+                break;
+            }
+            case 's':
+                sweep = 1;
+                break;
+            case 'w':
+                if (window_count == MAX_WINDOWS) usage(argv[0]);
+                windows[window_count] = atoi(optarg);
+                if (windows[window_count] <= 0) usage(argv[0]);
+                window_count++;
+                break;
+            case 'n':
+                show_samples = 0;
+                break;
+            case 'm':
+                max_silence = atoi(optarg);
+                if (max_silence <= 0) usage(argv[0]);
+                break;
+            case 'f':
+                fifo = optarg;
+                break;
+            case 't':
+                shard_count = atoi(optarg);
+                if (shard_count < 1 || shard_count > MAX_SHARDS) {
+                    usage(argv[0]);
+                }
+                break;
+            case 'j':
+                worker_count = atoi(optarg);
+                if (worker_count < 0 || worker_count > WORKPOOL_MAX_WORKERS) {
+                    usage(argv[0]);
+                }
+                break;
+            case 'a':
+                add_group(optarg);
+                break;
+            case 'k':
+                keepalive = (int)(atof(optarg) * 1000);
+                if (keepalive <= 0) usage(argv[0]);
+                break;
+            case 'c':
+                clock_interval = (int)(atof(optarg) * 1000);
+                if (clock_interval <= 0) usage(argv[0]);
+                break;
+            case 'B':
+                link_budget = atoi(optarg);
+                if (link_budget <= 0 || link_budget > 100) usage(argv[0]);
+                break;
+            case 'S':
+                statistics_interval = atoi(optarg);
+                if (statistics_interval <= 0) usage(argv[0]);
+                break;
+            case 'P':
+                if (!strcmp(optarg, "block")) {
+                    policy = RING_BLOCK;
+                } else if (!strcmp(optarg, "drop")) {
+                    policy = RING_DROP_OLDEST;
+                } else if (!strcmp(optarg, "rollup")) {
+                    policy = RING_ROLLUP_ONLY;
+                } else {
+                    usage(argv[0]);
+                }
+                break;
+            case 'o':
+                store_path = optarg;
+                break;
+            case 'r':
+                state_path = optarg;
+                break;
+            case 'T':
+                trace_path = optarg;
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (argc - optind > MAX_DEVICES) usage(argv[0]);
+    if (store_path && (store_fd = store_open(store_path)) < 0) {
+        fail("Could not open the store");
+    }
+    // The threads started below leave the signals to the main thread.
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+    // The trace is written at exit after the sink has been drained.
+    if (trace_path && !trace_start(trace_path)) {
+        fail("Could not start tracing");
+    }
+    sink_start(policy, store_fd);
+    if (state_path &&
+        !(state = state_open(state_path, MAX_DEVICES))) {
+        // Not fatal, the collector just starts from scratch, unless the
+        // file is something else, which may be a mistyped path.
+        if (errno == EINVAL) {
+            fprintf(stderr, "%s: %s is not a state file\n", argv[0],
+                    state_path);
+            exit(1);
+        }
+        perror("Could not map the state file");
+    }
+    for (index = optind; index < argc || device_count == 0; index++) {
+        char *device = index < argc ? argv[index] : DEVICE;
+        int addresses[BUS_MAX_UNITS];
+        int address_count = parse_addresses(device, addresses), unit, fd;
+        int first = device_count, line_baudrate = baudrate;
+        bus *line = address_count > 0 ? buses + bus_count++ : NULL;
+        if (line) bus_init(line);
+        // All units on a line use the same baudrate, so the one of the
+        // first unit is restored.
+        if (baudrate == BAUDRATE_AUTO && state) {
+            char name[DEVICE_PATH_LENGTH];
+            state_device *saved;
+            if (line) {
+                snprintf(name, sizeof(name), "%s@%d", device, addresses[0]);
+            } else {
+                snprintf(name, sizeof(name), "%s", device);
+            }
+            saved = state_device_of(state, name);
+            if (saved && saved->baudrate) line_baudrate = saved->baudrate;
+        }
+        fd = open_optical_eye(argv[0], device, line_baudrate, IS_8N2);
+        if (LOW_LATENCY) optical_eye_low_latency(argv[0], fd, device);
+        for (unit = 0; unit == 0 || unit < address_count; unit++) {
+            add_device(device, fd, line ? addresses[unit] :
+                       KMP_DEFAULT_ADDRESS, line, line_count, state);
+        }
+        if (line) {
+            fprintf(stderr, "%s: %s: %d units on a multi-drop line\n",
+                    argv[0], device, device_count - first);
+        }
+        line_count++;
+    }
+    for (index = 0; index < device_count; index++) {
+        int entry, window;
+        for (entry = 0; entry < schedule_count; entry++) {
+            clock_gettime(CLOCK_MONOTONIC, devices[index].next_poll + entry);
+            if (max_silence > 0) schedule[entry].filtered = 1;
+            devices[index].previous_time[entry].tv_sec = 0;
+            deadband_init(devices[index].deadbands + entry,
+                          schedule[entry].absolute, schedule[entry].relative,
+                          max_silence);
+            for (window = 0; window < window_count; window++) {
+                rollup_init(&devices[index].rollups[entry][window],
+                            windows[window]);
+            }
+        }
+    }
+    for (index = 0; index < shard_count; index++) {
+        shards[index].index = index;
+        pthread_mutex_init(&shards[index].lock, NULL);
+        // Nonblocking at both ends; a full pipe is a pending wakeup.
+        if (pipe(shards[index].wake_fds) < 0 ||
+            fcntl(shards[index].wake_fds[0], F_SETFL, O_NONBLOCK) < 0 ||
+            fcntl(shards[index].wake_fds[1], F_SETFL, O_NONBLOCK) < 0) {
+            fail("Could not create a shard wakeup pipe");
+        }
+    }
+    if (worker_count > 0 &&
+        !workpool_start(&pool, worker_count, shard_count, drain_mailbox)) {
+        fail("Could not start the decoding workers");
+    }
+    for (index = 1; index < shard_count; index++) {
+        if (pthread_create(&shards[index].thread, NULL, shard_thread,
+                           shards + index)) {
+            fail("Could not start a shard");
+        }
+    }
+    if (fifo) fifo_fd = open_fifo(fifo);
+    watch_fd = hotplug_watch();
+    if (shard_count > 1) pin_to_cpu(0);
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+    pthread_sigmask(SIG_UNBLOCK, &signals, NULL);
+    run_shard(shards, fifo_fd, watch_fd);
+    return 0;
+}
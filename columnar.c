@@ -0,0 +1,343 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "optical_eye_utils.h"
+#include "store.h"
+#include "variables.h"
+
+// Export the records of a store in a columnar layout, for tools which
+// load whole columns at a time. The records are split by time into
+// partitions, each a directory holding one file per field of the
+// records: a plain array of fixed width values in the byte order of the
+// machine, with the type as the extension of its name.
+//
+//   time.i64          Nanoseconds since the epoch.
+//   value.f64
+//   source.u32        A hash of the device name, see `store_source`.
+//   var_id.u16
+//   kind.u8           0: sample, 1-4: min, max, mean and last of a window.
+//   unit.u8           An index into units.txt.
+//   window.u32        Seconds, 0 for samples.
+//   count.u32         Samples in the window.
+//   meter_offset.i32  Milliseconds from the time to the meter's time,
+//   meter_error.i32   within this many milliseconds, -1: unknown.
+//
+// Each partition also holds manifest.txt giving its number of rows and
+// the times of its first and last rows. The output directory holds the
+// dictionaries: units.txt, which is the table of units known by the
+// meters, and variables.txt and sources.txt, naming the variables seen
+// and the devices given. As in query, giving devices exports only the
+// records read from them.
+//
+// The columns are buffered and written in blocks of COLUMNAR_BLOCK_ROWS
+// rows. The partition of a record is that of the one before it as long
+// as the records are in time order, as they are when they were written
+// by the collector or ingested from logs in order; a partition which is
+// left is closed, and appended to if it comes back.
+
+#ifndef COLUMNAR_BLOCK_ROWS
+#define COLUMNAR_BLOCK_ROWS 65536
+#endif
+#ifndef COLUMNAR_MAX_PARTITIONS
+#define COLUMNAR_MAX_PARTITIONS 4096
+#endif
+#define MAX_SOURCES 64
+#define PATH_LENGTH 512
+
+typedef struct _partition {
+    char name[32];
+    int64_t start, end;            // The time of the partition.
+    int64_t first, last;           // Of the rows in it.
+    unsigned long rows;
+} partition;
+
+static int64_t times[COLUMNAR_BLOCK_ROWS];
+static double values[COLUMNAR_BLOCK_ROWS];
+static uint32_t sources[COLUMNAR_BLOCK_ROWS];
+static uint16_t var_ids[COLUMNAR_BLOCK_ROWS];
+static uint8_t kinds[COLUMNAR_BLOCK_ROWS];
+static uint8_t units[COLUMNAR_BLOCK_ROWS];
+static uint32_t windows[COLUMNAR_BLOCK_ROWS];
+static uint32_t counts[COLUMNAR_BLOCK_ROWS];
+static int32_t meter_offsets[COLUMNAR_BLOCK_ROWS];
+static int32_t meter_errors[COLUMNAR_BLOCK_ROWS];
+static int rows = 0;
+
+typedef struct _column {
+    char const *name;
+    void const *data;
+    int width;
+    int fd;
+} column;
+
+static column columns[] = {
+    {"time.i64", times, sizeof(times[0])},
+    {"value.f64", values, sizeof(values[0])},
+    {"source.u32", sources, sizeof(sources[0])},
+    {"var_id.u16", var_ids, sizeof(var_ids[0])},
+    {"kind.u8", kinds, sizeof(kinds[0])},
+    {"unit.u8", units, sizeof(units[0])},
+    {"window.u32", windows, sizeof(windows[0])},
+    {"count.u32", counts, sizeof(counts[0])},
+    {"meter_offset.i32", meter_offsets, sizeof(meter_offsets[0])},
+    {"meter_error.i32", meter_errors, sizeof(meter_errors[0])},
+    {NULL}
+};
+
+static char const *directory;
+static store_buckets splitting;
+static partition partitions[COLUMNAR_MAX_PARTITIONS];
+static int partition_count = 0;
+static partition *current = NULL;
+static unsigned char var_map[65536 / 8];
+static char const *source_names[MAX_SOURCES];
+static uint32_t source_hashes[MAX_SOURCES];
+static int source_count = 0;
+
+void usage(char *self) {
+    printf("Usage: %s [-s seconds|hour|day|month] [-f YYYYMMDD[-HHMM]] "
+           "[-t YYYYMMDD[-HHMM]] [-m device]... store directory\n", self);
+    exit(0);
+}
+
+static void write_all(int fd, void const *buffer, size_t length)
+{
+    char const *next = buffer;
+    while (length > 0) {
+        ssize_t written = write(fd, next, length);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) fail("Could not write a column");
+        next += written;
+        length -= written;
+    }
+}
+
+// Create the file `name` in `subdirectory` of the output directory,
+// or in the output directory itself if it is NULL.
+static FILE *create_text(char const *subdirectory, char const *name)
+{
+    char path[PATH_LENGTH];
+    FILE *file;
+    if (subdirectory) {
+        snprintf(path, sizeof(path), "%s/%s/%s", directory, subdirectory,
+                 name);
+    } else {
+        snprintf(path, sizeof(path), "%s/%s", directory, name);
+    }
+    file = fopen(path, "w");
+    if (!file) fail(path);
+    return file;
+}
+
+static void flush_rows(void)
+{
+    column *c;
+    if (rows == 0) return;
+    for (c = columns; c->name; c++) {
+        write_all(c->fd, c->data, (size_t)rows * c->width);
+    }
+    rows = 0;
+}
+
+static void close_partition(void)
+{
+    column *c;
+    if (!current) return;
+    flush_rows();
+    for (c = columns; c->name; c++) close(c->fd);
+    current = NULL;
+}
+
+// Open the columns of `p`, truncating them when it is new.
+static void open_partition(partition *p, int fresh)
+{
+    char path[PATH_LENGTH];
+    column *c;
+    snprintf(path, sizeof(path), "%s/%s", directory, p->name);
+    if (mkdir(path, 0755) < 0 && errno != EEXIST) fail(path);
+    for (c = columns; c->name; c++) {
+        snprintf(path, sizeof(path), "%s/%s/%s", directory, p->name,
+                 c->name);
+        c->fd = open(path, O_WRONLY | O_CREAT |
+                     (fresh ? O_TRUNC : O_APPEND), 0644);
+        if (c->fd < 0) fail(path);
+    }
+    current = p;
+}
+
+// The partition of `time`: a local day or month, or seconds aligned to
+// the epoch, named by its start.
+static void partition_of(int64_t time, partition *p)
+{
+    struct tm tm;
+    time_t seconds;
+    memset(p, 0, sizeof(*p));
+    p->start = store_bucket_of(&splitting, time);
+    p->end = store_bucket_end(&splitting, p->start);
+    if (splitting.period == STORE_ALL) {
+        strcpy(p->name, "all");
+        return;
+    }
+    seconds = p->start / STORE_SECOND;
+    localtime_r(&seconds, &tm);
+    strftime(p->name, sizeof(p->name),
+             splitting.period == STORE_SECONDS ? "%Y%m%d-%H%M%S" :
+             splitting.period == STORE_MONTH ? "%Y%m" : "%Y%m%d", &tm);
+}
+
+// Make the partition of `time` the current one.
+static void enter_partition(int64_t time)
+{
+    partition found;
+    int index;
+    close_partition();
+    for (index = 0; index < partition_count; index++) {
+        partition *p = partitions + index;
+        if (time >= p->start && time < p->end) {
+            open_partition(p, 0);
+            return;
+        }
+    }
+    if (partition_count == COLUMNAR_MAX_PARTITIONS) {
+        fprintf(stderr, "More than %d partitions, split less\n",
+                COLUMNAR_MAX_PARTITIONS);
+        exit(1);
+    }
+    partition_of(time, &found);
+    found.first = found.last = time;
+    partitions[partition_count] = found;
+    open_partition(partitions + partition_count++, 1);
+}
+
+static void add_row(store_record const *record)
+{
+    if (!current || record->time < current->start ||
+        record->time >= current->end) {
+        enter_partition(record->time);
+    }
+    if (rows == COLUMNAR_BLOCK_ROWS) flush_rows();
+    times[rows] = record->time;
+    values[rows] = record->value;
+    sources[rows] = record->source;
+    var_ids[rows] = record->var_id;
+    kinds[rows] = record->kind;
+    units[rows] = record->unit;
+    windows[rows] = record->window;
+    counts[rows] = record->count;
+    meter_offsets[rows] = record->meter_offset;
+    meter_errors[rows] = record->meter_error;
+    rows++;
+    if (record->time < current->first) current->first = record->time;
+    if (record->time > current->last) current->last = record->time;
+    current->rows++;
+    var_map[record->var_id >> 3] |= 1 << (record->var_id & 7);
+}
+
+// Whether records from `source` are exported: all are if no devices
+// were given.
+static int selected(uint32_t source)
+{
+    int index;
+    if (source_count == 0) return 1;
+    for (index = 0; index < source_count; index++) {
+        if (source_hashes[index] == source) return 1;
+    }
+    return 0;
+}
+
+static void write_manifests(void)
+{
+    int index;
+    for (index = 0; index < partition_count; index++) {
+        partition const *p = partitions + index;
+        FILE *manifest = create_text(p->name, "manifest.txt");
+        fprintf(manifest, "rows %lu\nfirst %lld\nlast %lld\n", p->rows,
+                (long long)p->first, (long long)p->last);
+        fclose(manifest);
+    }
+}
+
+static void write_dictionaries(void)
+{
+    FILE *file = create_text(NULL, "units.txt");
+    char const *name;
+    int code;
+    for (code = 0; (name = unit_name(code)); code++) {
+        fprintf(file, "%d\t%s\n", code, name);
+    }
+    fclose(file);
+    file = create_text(NULL, "variables.txt");
+    for (code = 0; code < 65536; code++) {
+        if (var_map[code >> 3] >> (code & 7) & 1) {
+            fprintf(file, "%d\t%s\n", code, var_name_of_id(code));
+        }
+    }
+    fclose(file);
+    file = create_text(NULL, "sources.txt");
+    for (code = 0; code < source_count; code++) {
+        fprintf(file, "%u\t%s\n", source_hashes[code], source_names[code]);
+    }
+    fclose(file);
+}
+
+int main(int argc, char *argv[])
+{
+    store_record const *records;
+    size_t record_count, index;
+    unsigned long exported = 0;
+    int64_t from = INT64_MIN, to = INT64_MAX;
+    int option;
+
+    while ((option = getopt(argc, argv, "s:f:t:m:")) != -1) {
+        switch (option) {
+            case 's':
+                if (!store_buckets_init(&splitting, optarg)) usage(argv[0]);
+                break;
+            case 'f':
+                if (!store_parse_time(optarg, strlen(optarg), &from)) {
+                    usage(argv[0]);
+                }
+                break;
+            case 't':
+                if (!store_parse_time(optarg, strlen(optarg), &to)) {
+                    usage(argv[0]);
+                }
+                break;
+            case 'm':
+                if (source_count == MAX_SOURCES) usage(argv[0]);
+                source_names[source_count] = optarg;
+                source_hashes[source_count++] = store_source(optarg);
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (argc - optind != 2) usage(argv[0]);
+    records = store_map(argv[optind], &record_count);
+    if (!records) fail("Could not map the store");
+    directory = argv[optind + 1];
+    if (mkdir(directory, 0755) < 0 && errno != EEXIST) fail(directory);
+
+    for (index = 0; index < record_count; index++) {
+        if (records[index].time >= from && records[index].time < to &&
+            selected(records[index].source)) {
+            add_row(records + index);
+            exported++;
+        }
+    }
+    close_partition();
+    write_manifests();
+    write_dictionaries();
+    printf("%s: %lu of %zu records in %d partitions\n", argv[0], exported,
+           record_count, partition_count);
+    return 0;
+}
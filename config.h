@@ -5,3 +5,10 @@
 #include <termios.h>
 
 #define DEVICE "/dev/ttyUSB0"
+
+// Where the baudrate and framing detected for each device are cached.
+#define BAUDRATE_CACHE "/var/tmp/kamstrup-baudrates"
+
+// Set to 1 to configure the optical eye for low latency, which mainly
+// helps on FTDI style USB serial adapters.
+#define LOW_LATENCY 0
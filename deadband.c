@@ -0,0 +1,78 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#include <math.h>
+#include <stdlib.h>
+#include "deadband.h"
+#include "variables.h"
+
+void deadband_init(deadband *d, double absolute, double relative,
+                   int max_silence)
+{
+    d->absolute = absolute;
+    d->relative = relative;
+    d->max_silence = max_silence;
+    d->reported = 0;
+}
+
+int deadband_threshold(char const *arg, double *absolute, double *relative)
+{
+    char *end;
+    double threshold = strtod(arg, &end);
+    if (end == arg || threshold < 0) return 0;
+    *absolute = 0;
+    *relative = 0;
+    if (*end == '%') {
+        *relative = threshold / 100;
+        end++;
+    } else {
+        *absolute = threshold;
+    }
+    return *end == '\0';
+}
+
+static int silence_expired(deadband const *d, time_t now)
+{
+    return d->max_silence > 0 && now - d->last_time >= d->max_silence;
+}
+
+int deadband_value(deadband *d, time_t now, double value)
+{
+    if (d->reported && !silence_expired(d, now) &&
+        fabs(value - d->last) <= d->absolute + d->relative * fabs(d->last)) {
+        return 0;
+    }
+    d->reported = 1;
+    d->last = value;
+    d->last_time = now;
+    return 1;
+}
+
+int deadband_data(deadband *d, time_t now, unsigned char const *data,
+                  int length)
+{
+    // FNV-1a, so only a digest of the data needs to be kept.
+    unsigned int digest = 2166136261u;
+    int index;
+    for (index = 0; index < length; index++) {
+        digest = (digest ^ data[index]) * 16777619u;
+    }
+    if (d->reported && !silence_expired(d, now) && digest == d->digest) {
+        return 0;
+    }
+    d->reported = 1;
+    d->digest = digest;
+    d->last_time = now;
+    return 1;
+}
+
+int deadband_package(deadband *d, register_cache *cache, time_t now,
+                     unsigned char const *package, int length, int var_id)
+{
+    double value;
+    if (package_value(cache, package, length, var_id, &value)) {
+        return deadband_value(d, now, value);
+    }
+    return deadband_data(d, now, package, length);
+}
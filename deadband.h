@@ -0,0 +1,49 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#ifndef DEADBAND_H
+#define DEADBAND_H
+
+#include <time.h>
+
+// Change-only reporting of the samples of one register: a sample is
+// reported when it differs from the last reported one by more than the
+// threshold, or when nothing has been reported for `max_silence`
+// seconds. Values which are not numeric, e.g., dates and text, are
+// reported when their data differs.
+
+typedef struct _deadband {
+    double absolute;               // Threshold in the unit of the value.
+    double relative;               // Threshold as a fraction of the value.
+    int max_silence;               // Seconds, 0: no limit.
+    int reported;                  // Set when a sample has been reported.
+    double last;                   // Last reported numeric value.
+    unsigned int digest;           // Of the last reported data.
+    time_t last_time;              // When the last sample was reported.
+} deadband;
+
+// A threshold of zero reports every change.
+void deadband_init(deadband *d, double absolute, double relative,
+                   int max_silence);
+
+// Parse a threshold, "<number>" for an absolute threshold, and
+// "<number>%" for a relative one. Returns zero if `arg` is malformed.
+int deadband_threshold(char const *arg, double *absolute, double *relative);
+
+// Return 1 if the numeric sample `value` taken at `now` should be
+// reported, and record it as reported if so.
+int deadband_value(deadband *d, time_t now, double value);
+
+// As `deadband_value`, for a sample which is only known as `data`.
+int deadband_data(deadband *d, time_t now, unsigned char const *data,
+                  int length);
+
+struct _register_cache;
+
+// As `deadband_value` for the value in the descaped response package
+// for `var_id` if it is numeric, and otherwise as `deadband_data`.
+int deadband_package(deadband *d, struct _register_cache *cache, time_t now,
+                     unsigned char const *package, int length, int var_id);
+
+#endif
@@ -0,0 +1,211 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+// Check the bulk escape kernels in optical_eye_utils.c against the
+// byte-at-a-time functions they replaced, on every byte value, on
+// escapes at and around vector boundaries, on all short lengths, and
+// on random buffers. Exits nonzero if any result differs.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "optical_eye_utils.h"
+
+#if defined(SCAN_SCALAR)
+#define KERNEL "scalar"
+#elif defined(__AVX2__)
+#define KERNEL "AVX2"
+#elif defined(__SSE2__)
+#define KERNEL "SSE2"
+#else
+#define KERNEL "scalar"
+#endif
+
+#define MAX_WIDTH 32               // The widest vector, AVX2.
+#define MAX_LENGTH 1024
+#define PAD 64                     // Room for misalignment and overreads.
+#define RANDOM_ROUNDS 20000
+
+static unsigned char const specials[] = {0x06, 0x0d, 0x1b, 0x40, 0x80};
+static long cases = 0, failures = 0;
+
+static int reference_find_escape(unsigned char const *data, int length)
+{
+    int index;
+    for (index = 0; index < length; index++) {
+        if (data[index] == 0x1b) break;
+    }
+    return index;
+}
+
+static int reference_find_special(unsigned char const *data, int length)
+{
+    int index;
+    for (index = 0; index < length; index++) {
+        if (memchr(specials, data[index], sizeof(specials))) break;
+    }
+    return index;
+}
+
+// As optical_eye_write before the bulk kernels, into `frame`.
+static int reference_escape(unsigned char const *request, int request_length,
+                            unsigned char *frame)
+{
+    int index, frame_length = 0;
+    frame[frame_length++] = request[0];
+    for (index = 1; index < request_length - 1; index++) {
+        if (memchr(specials, request[index], sizeof(specials))) {
+            frame[frame_length++] = 0x1b;
+            frame[frame_length++] = request[index] ^ 0xff;
+        } else {
+            frame[frame_length++] = request[index];
+        }
+    }
+    frame[frame_length++] = request[request_length - 1];
+    return frame_length;
+}
+
+// As descape_package before the bulk kernels.
+static int reference_descape(unsigned char *buffer, int length)
+{
+    int index, offset = 0;
+    for (index = 0; index < length; index++) {
+        if (buffer[index] == 0x1b) {
+            index++; offset++;
+            buffer[index - offset] = buffer[index] ^ 0xff;
+        } else {
+            if (offset > 0) buffer[index - offset] = buffer[index];
+        }
+    }
+    return length - offset;
+}
+
+static void report(char const *what, char const *description,
+                   unsigned char const *data, int length)
+{
+    int index;
+    if (++failures > 10) return;
+    fprintf(stderr, "%s differs for %s, length %d:", what, description,
+            length);
+    for (index = 0; index < length && index < 80; index++) {
+        fprintf(stderr, " %02x", data[index]);
+    }
+    fprintf(stderr, "%s\n", index < length ? " ..." : "");
+}
+
+// Compare all four functions on the `length` bytes at `data`, which
+// must be followed by PAD readable bytes.
+static void check(unsigned char const *data, int length,
+                  char const *description)
+{
+    static unsigned char frame[2 * (MAX_LENGTH + PAD)];
+    static unsigned char expected_frame[2 * (MAX_LENGTH + PAD)];
+    static unsigned char buffer[MAX_LENGTH + PAD];
+    static unsigned char expected_buffer[MAX_LENGTH + PAD];
+    int result, expected;
+    cases++;
+    if (find_escape(data, length) != reference_find_escape(data, length)) {
+        report("find_escape", description, data, length);
+    }
+    if (find_special(data, length) != reference_find_special(data, length)) {
+        report("find_special", description, data, length);
+    }
+    if (length > 0) {
+        // A request always has its start and end marks.
+        result = escape_package(data, length, frame);
+        expected = reference_escape(data, length, expected_frame);
+        if (result != expected || memcmp(frame, expected_frame, result)) {
+            report("escape_package", description, data, length);
+        }
+    }
+    // A trailing escape reads the byte after the buffer, so both copies
+    // carry the same padding.
+    memcpy(buffer, data, length + PAD);
+    memcpy(expected_buffer, data, length + PAD);
+    result = descape_package(buffer, length);
+    expected = reference_descape(expected_buffer, length);
+    if (result != expected || memcmp(buffer, expected_buffer, result)) {
+        report("descape_package", description, data, length);
+    }
+}
+
+static void fill(unsigned char *data, int length, unsigned char plain)
+{
+    memset(data, plain, length + PAD);
+}
+
+int main(void)
+{
+    static unsigned char storage[MAX_LENGTH + 2 * PAD];
+    int length, position, special, start, round;
+    char description[80];
+
+    // Every byte value, at every alignment of the vectors.
+    for (start = 0; start < MAX_WIDTH; start++) {
+        unsigned char *data = storage + start;
+        fill(data, 256, 0x55);
+        for (position = 0; position < 256; position++) {
+            data[position] = position;
+        }
+        sprintf(description, "all byte values at offset %d", start);
+        check(data, 256, description);
+        for (position = 0; position < 256; position++) {
+            data[position] = 255 - position;
+        }
+        check(data, 256, description);
+    }
+
+    // All short lengths without escapes, and with a single special byte
+    // at each position, which covers the vector boundaries.
+    for (length = 0; length <= 2 * MAX_WIDTH + 1; length++) {
+        fill(storage, length, 0x55);
+        sprintf(description, "no escapes");
+        check(storage, length, description);
+        for (position = 0; position < length; position++) {
+            for (special = 0; special < sizeof(specials); special++) {
+                fill(storage, length, 0x55);
+                storage[position] = specials[special];
+                sprintf(description, "0x%02x at %d", specials[special],
+                        position);
+                check(storage, length, description);
+                // A neighbouring escape, straddling the boundary.
+                if (position + 1 < length) {
+                    storage[position + 1] = 0x1b;
+                    check(storage, length, description);
+                }
+            }
+        }
+    }
+
+    // Escapes right before, at and after each boundary of longer buffers.
+    for (position = MAX_WIDTH - 2; position < MAX_LENGTH;
+         position += MAX_WIDTH / 2) {
+        int at;
+        for (at = position - 1; at < position + 3; at++) {
+            fill(storage, MAX_LENGTH, 0x55);
+            storage[at] = 0x1b;
+            storage[at + 1] = 0xe4;
+            sprintf(description, "escape at %d", at);
+            check(storage, MAX_LENGTH, description);
+        }
+    }
+
+    // Random buffers with varying density of special bytes.
+    srand(1107);
+    for (round = 0; round < RANDOM_ROUNDS; round++) {
+        int density = 1 << (round % 9);   // One in `density`.
+        unsigned char *data = storage + rand() % PAD;
+        length = rand() % (MAX_LENGTH + 1);
+        for (position = 0; position < length + PAD; position++) {
+            data[position] = rand() % density ?
+                rand() % 256 : specials[rand() % sizeof(specials)];
+        }
+        sprintf(description, "random round %d", round);
+        check(data, length, description);
+    }
+
+    printf("escape_test: %s, %ld cases, %ld failures\n", KERNEL, cases,
+           failures);
+    return failures > 0;
+}
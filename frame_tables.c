@@ -0,0 +1,320 @@
+// Generated by mkframes, do not edit.
+
+#include "frames.h"
+
+request_frame const request_frames[] = {
+    {0, 10, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x00, 0x45, 0x1b, 0x7f, 0x0d}},
+    {1, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x01, 0x55, 0xa1, 0x0d}},
+    {2, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x02, 0x65, 0xc2, 0x0d}},
+    {3, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x03, 0x75, 0xe3, 0x0d}},
+    {4, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x04, 0x05, 0x04, 0x0d}},
+    {5, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x05, 0x15, 0x25, 0x0d}},
+    {6, 10, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x1b, 0xf9, 0x25, 0x46, 0x0d}},
+    {7, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x07, 0x35, 0x67, 0x0d}},
+    {8, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x08, 0xc4, 0x88, 0x0d}},
+    {9, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x09, 0xd4, 0xa9, 0x0d}},
+    {10, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x0a, 0xe4, 0xca, 0x0d}},
+    {11, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x0b, 0xf4, 0xeb, 0x0d}},
+    {12, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x0c, 0x84, 0x0c, 0x0d}},
+    {13, 10, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x1b, 0xf2, 0x94, 0x2d, 0x0d}},
+    {14, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x0e, 0xa4, 0x4e, 0x0d}},
+    {15, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x0f, 0xb4, 0x6f, 0x0d}},
+    {16, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x10, 0x57, 0xb1, 0x0d}},
+    {17, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x11, 0x47, 0x90, 0x0d}},
+    {18, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x12, 0x77, 0xf3, 0x0d}},
+    {19, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x13, 0x67, 0xd2, 0x0d}},
+    {20, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x14, 0x17, 0x35, 0x0d}},
+    {21, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x15, 0x07, 0x14, 0x0d}},
+    {22, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x16, 0x37, 0x77, 0x0d}},
+    {23, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x17, 0x27, 0x56, 0x0d}},
+    {24, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x18, 0xd6, 0xb9, 0x0d}},
+    {25, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x19, 0xc6, 0x98, 0x0d}},
+    {26, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x1a, 0xf6, 0xfb, 0x0d}},
+    {27, 10, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x1b, 0xe4, 0xe6, 0xda, 0x0d}},
+    {28, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x1c, 0x96, 0x3d, 0x0d}},
+    {29, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x1d, 0x86, 0x1c, 0x0d}},
+    {30, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x1e, 0xb6, 0x7f, 0x0d}},
+    {31, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x1f, 0xa6, 0x5e, 0x0d}},
+    {32, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x20, 0x61, 0xe2, 0x0d}},
+    {33, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x21, 0x71, 0xc3, 0x0d}},
+    {34, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x22, 0x41, 0xa0, 0x0d}},
+    {35, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x23, 0x51, 0x81, 0x0d}},
+    {36, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x24, 0x21, 0x66, 0x0d}},
+    {37, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x25, 0x31, 0x47, 0x0d}},
+    {38, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x26, 0x01, 0x24, 0x0d}},
+    {39, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x27, 0x11, 0x05, 0x0d}},
+    {40, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x28, 0xe0, 0xea, 0x0d}},
+    {41, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x29, 0xf0, 0xcb, 0x0d}},
+    {42, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x2a, 0xc0, 0xa8, 0x0d}},
+    {43, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x2b, 0xd0, 0x89, 0x0d}},
+    {44, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x2c, 0xa0, 0x6e, 0x0d}},
+    {45, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x2d, 0xb0, 0x4f, 0x0d}},
+    {46, 10, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x2e, 0x1b, 0x7f, 0x2c, 0x0d}},
+    {47, 10, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x2f, 0x90, 0x1b, 0xf2, 0x0d}},
+    {48, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x30, 0x73, 0xd3, 0x0d}},
+    {50, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x32, 0x53, 0x91, 0x0d}},
+    {51, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x33, 0x43, 0xb0, 0x0d}},
+    {52, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x34, 0x33, 0x57, 0x0d}},
+    {53, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x35, 0x23, 0x76, 0x0d}},
+    {54, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x36, 0x13, 0x15, 0x0d}},
+    {55, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x37, 0x03, 0x34, 0x0d}},
+    {56, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x38, 0xf2, 0xdb, 0x0d}},
+    {57, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x39, 0xe2, 0xfa, 0x0d}},
+    {58, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0x3a, 0xd2, 0x99, 0x0d}},
+    {199, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0xc7, 0xec, 0x2b, 0x0d}},
+    {222, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0xde, 0x6f, 0x33, 0x0d}},
+    {231, 9, {0x80, 0x3f, 0x10, 0x01, 0x00, 0xe7, 0xc8, 0x49, 0x0d}},
+    {1001, 9, {0x80, 0x3f, 0x10, 0x01, 0x03, 0xe9, 0x7c, 0xd4, 0x0d}},
+    {1002, 9, {0x80, 0x3f, 0x10, 0x01, 0x03, 0xea, 0x4c, 0xb7, 0x0d}},
+    {1003, 9, {0x80, 0x3f, 0x10, 0x01, 0x03, 0xeb, 0x5c, 0x96, 0x0d}},
+    {1004, 9, {0x80, 0x3f, 0x10, 0x01, 0x03, 0xec, 0x2c, 0x71, 0x0d}},
+    {1005, 9, {0x80, 0x3f, 0x10, 0x01, 0x03, 0xed, 0x3c, 0x50, 0x0d}},
+    {1010, 9, {0x80, 0x3f, 0x10, 0x01, 0x03, 0xf2, 0xdf, 0x8e, 0x0d}},
+    {1021, 9, {0x80, 0x3f, 0x10, 0x01, 0x03, 0xfd, 0x2e, 0x61, 0x0d}},
+    {1023, 9, {0x80, 0x3f, 0x10, 0x01, 0x03, 0xff, 0x0e, 0x23, 0x0d}},
+    {1024, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x00, 0x89, 0x44, 0x0d}},
+    {1025, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x01, 0x99, 0x65, 0x0d}},
+    {1026, 10, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x02, 0xa9, 0x1b, 0xf9, 0x0d}},
+    {1027, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x03, 0xb9, 0x27, 0x0d}},
+    {1028, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x04, 0xc9, 0xc0, 0x0d}},
+    {1029, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x05, 0xd9, 0xe1, 0x0d}},
+    {1030, 10, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x1b, 0xf9, 0xe9, 0x82, 0x0d}},
+    {1031, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x07, 0xf9, 0xa3, 0x0d}},
+    {1032, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x08, 0x08, 0x4c, 0x0d}},
+    {1033, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x09, 0x18, 0x6d, 0x0d}},
+    {1034, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x0a, 0x28, 0x0e, 0x0d}},
+    {1035, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x0b, 0x38, 0x2f, 0x0d}},
+    {1036, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x0c, 0x48, 0xc8, 0x0d}},
+    {1037, 10, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x1b, 0xf2, 0x58, 0xe9, 0x0d}},
+    {1038, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x0e, 0x68, 0x8a, 0x0d}},
+    {1039, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x0f, 0x78, 0xab, 0x0d}},
+    {1040, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x10, 0x9b, 0x75, 0x0d}},
+    {1043, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x13, 0xab, 0x16, 0x0d}},
+    {1044, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x14, 0xdb, 0xf1, 0x0d}},
+    {1045, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x15, 0xcb, 0xd0, 0x0d}},
+    {1046, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x16, 0xfb, 0xb3, 0x0d}},
+    {1047, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x17, 0xeb, 0x92, 0x0d}},
+    {1048, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x18, 0x1a, 0x7d, 0x0d}},
+    {1049, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x19, 0x0a, 0x5c, 0x0d}},
+    {1050, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x1a, 0x3a, 0x3f, 0x0d}},
+    {1051, 10, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x1b, 0xe4, 0x2a, 0x1e, 0x0d}},
+    {1054, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x1e, 0x7a, 0xbb, 0x0d}},
+    {1055, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x1f, 0x6a, 0x9a, 0x0d}},
+    {1056, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x20, 0xad, 0x26, 0x0d}},
+    {1058, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x22, 0x8d, 0x64, 0x0d}},
+    {1059, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x23, 0x9d, 0x45, 0x0d}},
+    {1060, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x24, 0xed, 0xa2, 0x0d}},
+    {1061, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x25, 0xfd, 0x83, 0x0d}},
+    {1062, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x26, 0xcd, 0xe0, 0x0d}},
+    {1063, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x27, 0xdd, 0xc1, 0x0d}},
+    {1064, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x28, 0x2c, 0x2e, 0x0d}},
+    {1065, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x29, 0x3c, 0x0f, 0x0d}},
+    {1066, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x2a, 0x0c, 0x6c, 0x0d}},
+    {1067, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x2b, 0x1c, 0x4d, 0x0d}},
+    {1068, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x2c, 0x6c, 0xaa, 0x0d}},
+    {1069, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x2d, 0x7c, 0x8b, 0x0d}},
+    {1070, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x2e, 0x4c, 0xe8, 0x0d}},
+    {1071, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x2f, 0x5c, 0xc9, 0x0d}},
+    {1072, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x30, 0xbf, 0x17, 0x0d}},
+    {1073, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x31, 0xaf, 0x36, 0x0d}},
+    {1074, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x32, 0x9f, 0x55, 0x0d}},
+    {1075, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x33, 0x8f, 0x74, 0x0d}},
+    {1076, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x34, 0xff, 0x93, 0x0d}},
+    {1077, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x35, 0xef, 0xb2, 0x0d}},
+    {1078, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x36, 0xdf, 0xd1, 0x0d}},
+    {1079, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x37, 0xcf, 0xf0, 0x0d}},
+    {1080, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x38, 0x3e, 0x1f, 0x0d}},
+    {1081, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x39, 0x2e, 0x3e, 0x0d}},
+    {1082, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x3a, 0x1e, 0x5d, 0x0d}},
+    {1083, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x3b, 0x0e, 0x7c, 0x0d}},
+    {1084, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x3c, 0x7e, 0x9b, 0x0d}},
+    {1085, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x3d, 0x6e, 0xba, 0x0d}},
+    {1086, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x3e, 0x5e, 0xd9, 0x0d}},
+    {1087, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x3f, 0x4e, 0xf8, 0x0d}},
+    {1088, 11, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x1b, 0xbf, 0xc1, 0x1b, 0x7f, 0x0d}},
+    {1089, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x41, 0xd1, 0xa1, 0x0d}},
+    {1090, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x42, 0xe1, 0xc2, 0x0d}},
+    {1091, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x43, 0xf1, 0xe3, 0x0d}},
+    {1092, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x44, 0x81, 0x04, 0x0d}},
+    {1101, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x4d, 0x10, 0x2d, 0x0d}},
+    {1102, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x4e, 0x20, 0x4e, 0x0d}},
+    {1108, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x54, 0x93, 0x35, 0x0d}},
+    {1109, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x55, 0x83, 0x14, 0x0d}},
+    {1110, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x56, 0xb3, 0x77, 0x0d}},
+    {1111, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x57, 0xa3, 0x56, 0x0d}},
+    {1112, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x58, 0x52, 0xb9, 0x0d}},
+    {1113, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x59, 0x42, 0x98, 0x0d}},
+    {1114, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x5a, 0x72, 0xfb, 0x0d}},
+    {1115, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x5b, 0x62, 0xda, 0x0d}},
+    {1116, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x5c, 0x12, 0x3d, 0x0d}},
+    {1117, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x5d, 0x02, 0x1c, 0x0d}},
+    {1118, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x5e, 0x32, 0x7f, 0x0d}},
+    {1119, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x5f, 0x22, 0x5e, 0x0d}},
+    {1120, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x60, 0xe5, 0xe2, 0x0d}},
+    {1121, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x61, 0xf5, 0xc3, 0x0d}},
+    {1122, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x62, 0xc5, 0xa0, 0x0d}},
+    {1123, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x63, 0xd5, 0x81, 0x0d}},
+    {1124, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x64, 0xa5, 0x66, 0x0d}},
+    {1125, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x65, 0xb5, 0x47, 0x0d}},
+    {1126, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x66, 0x85, 0x24, 0x0d}},
+    {1127, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x67, 0x95, 0x05, 0x0d}},
+    {1128, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x68, 0x64, 0xea, 0x0d}},
+    {1129, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x69, 0x74, 0xcb, 0x0d}},
+    {1130, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x6a, 0x44, 0xa8, 0x0d}},
+    {1131, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x6b, 0x54, 0x89, 0x0d}},
+    {1132, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x6c, 0x24, 0x6e, 0x0d}},
+    {1133, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x6d, 0x34, 0x4f, 0x0d}},
+    {1134, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x6e, 0x04, 0x2c, 0x0d}},
+    {1135, 10, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x6f, 0x14, 0x1b, 0xf2, 0x0d}},
+    {1136, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x70, 0xf7, 0xd3, 0x0d}},
+    {1137, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x71, 0xe7, 0xf2, 0x0d}},
+    {1138, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x72, 0xd7, 0x91, 0x0d}},
+    {1139, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x73, 0xc7, 0xb0, 0x0d}},
+    {1140, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x74, 0xb7, 0x57, 0x0d}},
+    {1141, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x75, 0xa7, 0x76, 0x0d}},
+    {1142, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x76, 0x97, 0x15, 0x0d}},
+    {1143, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x77, 0x87, 0x34, 0x0d}},
+    {1144, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x78, 0x76, 0xdb, 0x0d}},
+    {1145, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x79, 0x66, 0xfa, 0x0d}},
+    {1146, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x7a, 0x56, 0x99, 0x0d}},
+    {1147, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x7b, 0x46, 0xb8, 0x0d}},
+    {1148, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x7c, 0x36, 0x5f, 0x0d}},
+    {1149, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x7d, 0x26, 0x7e, 0x0d}},
+    {1150, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x7e, 0x16, 0x1d, 0x0d}},
+    {1151, 10, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x7f, 0x1b, 0xf9, 0x3c, 0x0d}},
+    {1152, 10, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x1b, 0x7f, 0x18, 0xcc, 0x0d}},
+    {1153, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x81, 0x08, 0xed, 0x0d}},
+    {1154, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x82, 0x38, 0x8e, 0x0d}},
+    {1155, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x83, 0x28, 0xaf, 0x0d}},
+    {1156, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x84, 0x58, 0x48, 0x0d}},
+    {1157, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x85, 0x48, 0x69, 0x0d}},
+    {1158, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x86, 0x78, 0x0a, 0x0d}},
+    {1159, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x87, 0x68, 0x2b, 0x0d}},
+    {1160, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x88, 0x99, 0xc4, 0x0d}},
+    {1161, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x89, 0x89, 0xe5, 0x0d}},
+    {1162, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x8a, 0xb9, 0x86, 0x0d}},
+    {1163, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x8b, 0xa9, 0xa7, 0x0d}},
+    {1164, 10, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x8c, 0xd9, 0x1b, 0xbf, 0x0d}},
+    {1165, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x8d, 0xc9, 0x61, 0x0d}},
+    {1166, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x8e, 0xf9, 0x02, 0x0d}},
+    {1167, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x8f, 0xe9, 0x23, 0x0d}},
+    {1168, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x90, 0x0a, 0xfd, 0x0d}},
+    {1169, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x91, 0x1a, 0xdc, 0x0d}},
+    {1170, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x92, 0x2a, 0xbf, 0x0d}},
+    {1171, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x93, 0x3a, 0x9e, 0x0d}},
+    {1172, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x94, 0x4a, 0x79, 0x0d}},
+    {1173, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x95, 0x5a, 0x58, 0x0d}},
+    {1174, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x96, 0x6a, 0x3b, 0x0d}},
+    {1175, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x97, 0x7a, 0x1a, 0x0d}},
+    {1179, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x9b, 0xbb, 0x96, 0x0d}},
+    {1180, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x9c, 0xcb, 0x71, 0x0d}},
+    {1181, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x9d, 0xdb, 0x50, 0x0d}},
+    {1182, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x9e, 0xeb, 0x33, 0x0d}},
+    {1183, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0x9f, 0xfb, 0x12, 0x0d}},
+    {1184, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xa0, 0x3c, 0xae, 0x0d}},
+    {1185, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xa1, 0x2c, 0x8f, 0x0d}},
+    {1187, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xa3, 0x0c, 0xcd, 0x0d}},
+    {1188, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xa4, 0x7c, 0x2a, 0x0d}},
+    {1189, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xa5, 0x6c, 0x0b, 0x0d}},
+    {1190, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xa6, 0x5c, 0x68, 0x0d}},
+    {1191, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xa7, 0x4c, 0x49, 0x0d}},
+    {1192, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xa8, 0xbd, 0xa6, 0x0d}},
+    {1193, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xa9, 0xad, 0x87, 0x0d}},
+    {1194, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xaa, 0x9d, 0xe4, 0x0d}},
+    {1195, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xab, 0x8d, 0xc5, 0x0d}},
+    {1196, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xac, 0xfd, 0x22, 0x0d}},
+    {1197, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xad, 0xed, 0x03, 0x0d}},
+    {1198, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xae, 0xdd, 0x60, 0x0d}},
+    {1199, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xaf, 0xcd, 0x41, 0x0d}},
+    {1200, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xb0, 0x2e, 0x9f, 0x0d}},
+    {1201, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xb1, 0x3e, 0xbe, 0x0d}},
+    {1202, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xb2, 0x0e, 0xdd, 0x0d}},
+    {1203, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xb3, 0x1e, 0xfc, 0x0d}},
+    {1204, 10, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xb4, 0x6e, 0x1b, 0xe4, 0x0d}},
+    {1205, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xb5, 0x7e, 0x3a, 0x0d}},
+    {1206, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xb6, 0x4e, 0x59, 0x0d}},
+    {1207, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xb7, 0x5e, 0x78, 0x0d}},
+    {1208, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xb8, 0xaf, 0x97, 0x0d}},
+    {1209, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xb9, 0xbf, 0xb6, 0x0d}},
+    {1210, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xba, 0x8f, 0xd5, 0x0d}},
+    {1211, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xbb, 0x9f, 0xf4, 0x0d}},
+    {1212, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xbc, 0xef, 0x13, 0x0d}},
+    {1213, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xbd, 0xff, 0x32, 0x0d}},
+    {1214, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xbe, 0xcf, 0x51, 0x0d}},
+    {1215, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xbf, 0xdf, 0x70, 0x0d}},
+    {1216, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xc0, 0x50, 0x08, 0x0d}},
+    {1217, 10, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xc1, 0x1b, 0xbf, 0x29, 0x0d}},
+    {1218, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xc2, 0x70, 0x4a, 0x0d}},
+    {1219, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xc3, 0x60, 0x6b, 0x0d}},
+    {1220, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xc4, 0x10, 0x8c, 0x0d}},
+    {1221, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xc5, 0x00, 0xad, 0x0d}},
+    {1222, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xc6, 0x30, 0xce, 0x0d}},
+    {1223, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xc7, 0x20, 0xef, 0x0d}},
+    {1224, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xc8, 0xd1, 0x00, 0x0d}},
+    {1225, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xc9, 0xc1, 0x21, 0x0d}},
+    {1226, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xca, 0xf1, 0x42, 0x0d}},
+    {1227, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xcb, 0xe1, 0x63, 0x0d}},
+    {1228, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xcc, 0x91, 0x84, 0x0d}},
+    {1229, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xcd, 0x81, 0xa5, 0x0d}},
+    {1230, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xce, 0xb1, 0xc6, 0x0d}},
+    {1231, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xcf, 0xa1, 0xe7, 0x0d}},
+    {1232, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xd0, 0x42, 0x39, 0x0d}},
+    {1233, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xd1, 0x52, 0x18, 0x0d}},
+    {1234, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xd2, 0x62, 0x7b, 0x0d}},
+    {1235, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xd3, 0x72, 0x5a, 0x0d}},
+    {1236, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xd4, 0x02, 0xbd, 0x0d}},
+    {1237, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xd5, 0x12, 0x9c, 0x0d}},
+    {1238, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xd6, 0x22, 0xff, 0x0d}},
+    {1239, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xd7, 0x32, 0xde, 0x0d}},
+    {1240, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xd8, 0xc3, 0x31, 0x0d}},
+    {1241, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xd9, 0xd3, 0x10, 0x0d}},
+    {1242, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xda, 0xe3, 0x73, 0x0d}},
+    {1243, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xdb, 0xf3, 0x52, 0x0d}},
+    {1244, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xdc, 0x83, 0xb5, 0x0d}},
+    {1245, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xdd, 0x93, 0x94, 0x0d}},
+    {1246, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xde, 0xa3, 0xf7, 0x0d}},
+    {1247, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xdf, 0xb3, 0xd6, 0x0d}},
+    {1248, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xe0, 0x74, 0x6a, 0x0d}},
+    {1249, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xe1, 0x64, 0x4b, 0x0d}},
+    {1250, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xe2, 0x54, 0x28, 0x0d}},
+    {1251, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xe3, 0x44, 0x09, 0x0d}},
+    {1252, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xe4, 0x34, 0xee, 0x0d}},
+    {1253, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xe5, 0x24, 0xcf, 0x0d}},
+    {1254, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xe6, 0x14, 0xac, 0x0d}},
+    {1255, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xe7, 0x04, 0x8d, 0x0d}},
+    {1256, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xe8, 0xf5, 0x62, 0x0d}},
+    {1257, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xe9, 0xe5, 0x43, 0x0d}},
+    {1258, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xea, 0xd5, 0x20, 0x0d}},
+    {1259, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xeb, 0xc5, 0x01, 0x0d}},
+    {1260, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xec, 0xb5, 0xe6, 0x0d}},
+    {1261, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xed, 0xa5, 0xc7, 0x0d}},
+    {1262, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xee, 0x95, 0xa4, 0x0d}},
+    {1263, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xef, 0x85, 0x85, 0x0d}},
+    {1264, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xf0, 0x66, 0x5b, 0x0d}},
+    {1265, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xf1, 0x76, 0x7a, 0x0d}},
+    {1266, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xf2, 0x46, 0x19, 0x0d}},
+    {1267, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xf3, 0x56, 0x38, 0x0d}},
+    {1268, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xf4, 0x26, 0xdf, 0x0d}},
+    {1269, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xf5, 0x36, 0xfe, 0x0d}},
+    {1270, 10, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xf6, 0x1b, 0xf9, 0x9d, 0x0d}},
+    {1271, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xf7, 0x16, 0xbc, 0x0d}},
+    {1272, 9, {0x80, 0x3f, 0x10, 0x01, 0x04, 0xf8, 0xe7, 0x53, 0x0d}},
+    {1536, 10, {0x80, 0x3f, 0x10, 0x01, 0x1b, 0xf9, 0x00, 0xef, 0x26, 0x0d}},
+    {1537, 10, {0x80, 0x3f, 0x10, 0x01, 0x1b, 0xf9, 0x01, 0xff, 0x07, 0x0d}},
+    {1538, 10, {0x80, 0x3f, 0x10, 0x01, 0x1b, 0xf9, 0x02, 0xcf, 0x64, 0x0d}},
+    {2010, 9, {0x80, 0x3f, 0x10, 0x01, 0x07, 0xda, 0xb6, 0x20, 0x0d}},
+    {2011, 9, {0x80, 0x3f, 0x10, 0x01, 0x07, 0xdb, 0xa6, 0x01, 0x0d}},
+    {2018, 9, {0x80, 0x3f, 0x10, 0x01, 0x07, 0xe2, 0x01, 0x7b, 0x0d}},
+};
+
+int const request_frames_length = 302;
+
+batch_frame const batch_frames[] = {
+    {"energy", 4, {1, 2, 3, 4}, 15, {0x80, 0x3f, 0x10, 0x04, 0x00, 0x01, 0x00, 0x02, 0x00, 0x03, 0x00, 0x04, 0x99, 0x3b, 0x0d}},
+    {"clock", 2, {1002, 1003}, 11, {0x80, 0x3f, 0x10, 0x02, 0x03, 0xea, 0x03, 0xeb, 0x68, 0x59, 0x0d}},
+    {"voltage", 3, {1054, 1055, 1056}, 13, {0x80, 0x3f, 0x10, 0x03, 0x04, 0x1e, 0x04, 0x1f, 0x04, 0x20, 0x09, 0x36, 0x0d}},
+    {"current", 3, {1076, 1077, 1078}, 13, {0x80, 0x3f, 0x10, 0x03, 0x04, 0x34, 0x04, 0x35, 0x04, 0x36, 0x74, 0xdc, 0x0d}},
+    {"power", 4, {1023, 1080, 1081, 1082}, 15, {0x80, 0x3f, 0x10, 0x04, 0x03, 0xff, 0x04, 0x38, 0x04, 0x39, 0x04, 0x3a, 0xd3, 0x73, 0x0d}},
+    {"phases", 6, {1054, 1055, 1056, 1076, 1077, 1078}, 20, {0x80, 0x3f, 0x10, 0x1b, 0xf9, 0x04, 0x1e, 0x04, 0x1f, 0x04, 0x20, 0x04, 0x34, 0x04, 0x35, 0x04, 0x36, 0x34, 0xfb, 0x0d}},
+    {0, 0, {0}, 0, {0}}
+};
@@ -0,0 +1,32 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#include <string.h>
+#include "frames.h"
+
+request_frame const *request_frame_of(int var_id)
+{
+    int low = 0, high = request_frames_length;
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (request_frames[middle].var_id < var_id) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low < request_frames_length && request_frames[low].var_id == var_id) {
+        return request_frames + low;
+    }
+    return NULL;
+}
+
+batch_frame const *batch_frame_of(char const *name)
+{
+    batch_frame const *batch;
+    for (batch = batch_frames; batch->name; batch++) {
+        if (!strcmp(batch->name, name)) return batch;
+    }
+    return NULL;
+}
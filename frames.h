@@ -0,0 +1,50 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#ifndef FRAMES_H
+#define FRAMES_H
+
+// Request frames as they go on the wire, i.e., escaped and with the CRC
+// filled in. The tables are generated at build time by `mkframes` into
+// frame_tables.c, for every register in `var_data` and for the batches
+// of registers which are commonly read together.
+
+#ifndef BATCH_MAX_REGISTERS
+#define BATCH_MAX_REGISTERS 8
+#endif
+
+// An escaped request has the start and end token plus at most twice the
+// number of bytes in between: the address, the command, the count, two
+// bytes per register and the CRC.
+#define REQUEST_FRAME_LENGTH (2 + 2 * 7)
+#define BATCH_FRAME_LENGTH (2 + 2 * (5 + 2 * BATCH_MAX_REGISTERS))
+
+typedef struct _request_frame {
+    unsigned short var_id;
+    unsigned char length;
+    unsigned char bytes[REQUEST_FRAME_LENGTH];
+} request_frame;
+
+typedef struct _batch_frame {
+    char const *name;
+    int count;
+    unsigned short var_ids[BATCH_MAX_REGISTERS];
+    unsigned char length;
+    unsigned char bytes[BATCH_FRAME_LENGTH];
+} batch_frame;
+
+// Sorted by `var_id`.
+extern request_frame const request_frames[];
+extern int const request_frames_length;
+
+// Terminated by an entry whose name is NULL.
+extern batch_frame const batch_frames[];
+
+// The frame reading `var_id`, or NULL if it is not a known register.
+request_frame const *request_frame_of(int var_id);
+
+// The batch named `name`, or NULL if there is no such batch.
+batch_frame const *batch_frame_of(char const *name);
+
+#endif
@@ -0,0 +1,61 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#include <string.h>
+#include <time.h>
+#include "health.h"
+#include "optical_eye_utils.h"
+
+void health_init(health *h)
+{
+    memset(h, 0, sizeof(*h));
+    h->state = CIRCUIT_CLOSED;
+    h->backoff = HEALTH_MIN_BACKOFF;
+}
+
+static void schedule_probe(health *h)
+{
+    clock_gettime(CLOCK_MONOTONIC, &h->next_probe);
+    h->next_probe.tv_sec += h->backoff / 1000;
+    h->next_probe.tv_nsec += (h->backoff % 1000) * 1000000L;
+    if (h->next_probe.tv_nsec >= 1000000000L) {
+        h->next_probe.tv_sec++;
+        h->next_probe.tv_nsec -= 1000000000L;
+    }
+}
+
+void health_success(health *h)
+{
+    h->exchanges++;
+    h->consecutive_failures = 0;
+    h->state = CIRCUIT_CLOSED;
+    h->backoff = HEALTH_MIN_BACKOFF;
+}
+
+void health_failure(health *h, int timed_out)
+{
+    h->exchanges++;
+    if (timed_out) h->timeouts++; else h->corrupted++;
+    h->consecutive_failures++;
+    if (h->state == CIRCUIT_CLOSED &&
+        h->consecutive_failures >= HEALTH_FAILURE_THRESHOLD) {
+        h->state = CIRCUIT_OPEN;
+        h->backoff = HEALTH_MIN_BACKOFF;
+        schedule_probe(h);
+    }
+}
+
+int health_probe_delay(health const *h)
+{
+    int delay = -milliseconds_since(&h->next_probe);
+    return delay > 0 ? delay : 0;
+}
+
+void health_probe_sent(health *h)
+{
+    // If the probe fails, the next one comes after twice the backoff.
+    h->backoff *= 2;
+    if (h->backoff > HEALTH_MAX_BACKOFF) h->backoff = HEALTH_MAX_BACKOFF;
+    schedule_probe(h);
+}
@@ -0,0 +1,53 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#ifndef HEALTH_H
+#define HEALTH_H
+
+#include <time.h>
+
+// Health tracking for one device, as a circuit breaker: after a number
+// of consecutive failed exchanges (timeouts or CRC failures) the
+// circuit opens, and requests are refused rather than each costing a
+// full timeout. While open, the device is probed with a cheap request,
+// with exponential backoff between probes; a successful probe closes
+// the circuit again.
+
+#define HEALTH_FAILURE_THRESHOLD 5 // Consecutive failures opening it.
+#define HEALTH_MIN_BACKOFF 1000    // Milliseconds before the first probe.
+#define HEALTH_MAX_BACKOFF 300000  // Milliseconds.
+
+// The probe reads "Internal number" (1030), like the heartbeat frame.
+#define HEALTH_PROBE_VAR_ID 1030
+
+typedef enum _circuit_state {
+    CIRCUIT_CLOSED,                // Requests are sent.
+    CIRCUIT_OPEN,                  // Requests are refused; probing.
+} circuit_state;
+
+typedef struct _health {
+    circuit_state state;
+    int consecutive_failures;
+    int backoff;                   // Milliseconds between probes.
+    struct timespec next_probe;
+    unsigned long exchanges;
+    unsigned long timeouts;
+    unsigned long corrupted;       // E.g., CRC failures.
+} health;
+
+void health_init(health *h);
+
+void health_success(health *h);
+
+// Record a failed exchange, `timed_out` if no complete response arrived.
+void health_failure(health *h, int timed_out);
+
+// Milliseconds until the next probe is due, 0 if it is due now. Only
+// meaningful when the circuit is open.
+int health_probe_delay(health const *h);
+
+// Record that a probe has been sent, scheduling the next one.
+void health_probe_sent(health *h);
+
+#endif
@@ -4,25 +4,26 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stropts.h>
 #include <unistd.h>
 #include "config.h"
+#include "frames.h"
 #include "optical_eye_utils.h"
+#include "output.h"
+#include "pacing.h"
 
 #define DEFAULT_BAUDRATE B9600
 
-static char heartbeat_message[] = {
-    '\x80', '\x3f', '\x10', '\x01', '\x04',
-    '\x1b', '\xf9', '\xe9', '\x82', '\x0d'
-};
-static int heartbeat_message_length = 10;
+#define HEARTBEAT_VAR_ID 1030 // Internal number.
 
 int main(int argc, char *argv[])
 {
     char *device = DEVICE;
     int baudrate = DEFAULT_BAUDRATE;
-    if (argc > 3) {
-        printf("Usage: %s [device [baudrate]]\n", argv[0]);
+    int raw = 0; // Pass the received bytes through unchanged.
+    if (argc > 4 || (argc == 4 && strcmp(argv[3], "raw"))) {
+        printf("Usage: %s [device [baudrate [raw]]]\n", argv[0]);
         exit(0);
     }
     if (argc > 1) {
@@ -33,22 +34,42 @@ int main(int argc, char *argv[])
         baudrate = baudrate_of(argv[0], argv[2]);
         printf("%s: using baudrate %s\n", argv[0], argv[2]);
     }
-    int optical_eye_fd = setup_optical_eye(device, baudrate, IS_8N2);
+    if (argc > 3) raw = 1;
+    int optical_eye_fd = open_optical_eye(argv[0], device, baudrate, IS_8N2);
+    if (LOW_LATENCY) optical_eye_low_latency(argv[0], optical_eye_fd, device);
+    request_frame const *request = request_frame_of(HEARTBEAT_VAR_ID);
+    pacing p;
+    pacing_init(&p);
 
     while (1) {
-        write(optical_eye_fd, heartbeat_message, heartbeat_message_length);
+        struct timespec start;
         int received_total = 0;
         char c = '\0';
+        pacing_wait(&p);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        write(optical_eye_fd, request->bytes, request->length);
         while (received_total < 25 || c != '\r') {
+            int remaining = pacing_timeout(&p) - milliseconds_since(&start);
+            if (!optical_eye_readable(optical_eye_fd, remaining)) break;
             int received = read(optical_eye_fd, &c, sizeof(c));
             if (received == 1) {
                 received_total++;
-                show_char(c);
-                if (c == '\r') printf("\n");
+                if (raw) {
+                    output_bytes(&c, 1);
+                } else {
+                    output_char(c);
+                    if (c == '\r') output_string("\n");
+                }
             }
             ioctl(optical_eye_fd, I_FLUSH, FLUSHW);
         }
-        sleep(1);
+        if (received_total >= 25 && c == '\r') {
+            pacing_success(&p, milliseconds_since(&start));
+        } else {
+            if (!raw) output_string("[timeout]\n");
+            pacing_failure(&p);
+        }
+        output_flush();
     }
     return 0;
 }
@@ -0,0 +1,96 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <termios.h>
+#include <unistd.h>
+#include "hotplug.h"
+#include "optical_eye_utils.h"
+
+int hotplug_watch(void)
+{
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) return -1;
+    if (inotify_add_watch(fd, "/dev", IN_CREATE | IN_ATTRIB) < 0) {
+        close(fd);
+        return -1;
+    }
+    // The directory only exists while some USB serial device is present;
+    // its creation is seen through the watch on /dev.
+    inotify_add_watch(fd, STABLE_DEVICE_DIRECTORY, IN_CREATE | IN_ATTRIB);
+    return fd;
+}
+
+int hotplug_changed(int watch_fd)
+{
+    char events[4096]
+        __attribute__((aligned(__alignof__(struct inotify_event))));
+    int changed = 0, length;
+    while ((length = read(watch_fd, events, sizeof(events))) > 0) {
+        char *position = events;
+        while (position < events + length) {
+            struct inotify_event *event = (struct inotify_event *)position;
+            if (event->len > 0 &&
+                (!strncmp(event->name, "tty", 3) ||
+                 !strcmp(event->name, "serial") ||
+                 !strncmp(event->name, "usb", 3))) {
+                changed = 1;
+            }
+            if (event->mask & IN_Q_OVERFLOW) changed = 1;
+            position += sizeof(struct inotify_event) + event->len;
+        }
+    }
+    if (changed) {
+        // Watch the stable names as soon as the directory appears.
+        inotify_add_watch(watch_fd, STABLE_DEVICE_DIRECTORY,
+                          IN_CREATE | IN_ATTRIB);
+    }
+    return changed;
+}
+
+void stable_device_path(char const *device, char *stable, int length)
+{
+    char resolved[PATH_MAX], candidate[PATH_MAX], target[PATH_MAX];
+    DIR *directory;
+    struct dirent *entry;
+    snprintf(stable, length, "%s", device);
+    if (!realpath(device, resolved)) return;
+    directory = opendir(STABLE_DEVICE_DIRECTORY);
+    if (!directory) return;
+    while ((entry = readdir(directory))) {
+        if (entry->d_name[0] == '.') continue;
+        snprintf(candidate, sizeof(candidate), "%s/%s",
+                 STABLE_DEVICE_DIRECTORY, entry->d_name);
+        if (realpath(candidate, target) && !strcmp(target, resolved)) {
+            snprintf(stable, length, "%s", candidate);
+            break;
+        }
+    }
+    closedir(directory);
+}
+
+int reopen_optical_eye(char const *optical_eye_device,
+                       int optical_eye_baudrate, int is_7e1)
+{
+    int fd = open(optical_eye_device, O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    if (configure_optical_eye(fd, optical_eye_baudrate, is_7e1)) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int optical_eye_baudrate(int fd)
+{
+    struct termios config;
+    if (tcgetattr(fd, &config) < 0) return -1;
+    return cfgetospeed(&config);
+}
@@ -0,0 +1,38 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#ifndef HOTPLUG_H
+#define HOTPLUG_H
+
+// Support for reopening USB optical eyes which have been unplugged or
+// have re-enumerated: device nodes are watched using inotify, devices
+// are identified by their stable name in /dev/serial/by-id, and the
+// device is reopened and reconfigured without exiting on failure.
+
+#define STABLE_DEVICE_DIRECTORY "/dev/serial/by-id"
+
+// Milliseconds between attempts to reopen a device when no device node
+// events arrive, e.g., when inotify is not available.
+#define HOTPLUG_RETRY_INTERVAL 1000
+
+// Start watching for device nodes being created or changed. Returns a
+// file descriptor which becomes readable on such events, or -1.
+int hotplug_watch(void);
+
+// Consume the pending events on `watch_fd`. Returns nonzero if any of
+// them may concern a serial device.
+int hotplug_changed(int watch_fd);
+
+// Store the name of `device` in STABLE_DEVICE_DIRECTORY into `stable`
+// if it has one, and otherwise `device` itself.
+void stable_device_path(char const *device, char *stable, int length);
+
+// Open and configure the optical eye, returning -1 on failure.
+int reopen_optical_eye(char const *optical_eye_device,
+                       int optical_eye_baudrate, int is_7e1);
+
+// The baudrate the optical eye `fd` is configured for.
+int optical_eye_baudrate(int fd);
+
+#endif
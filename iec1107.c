@@ -7,10 +7,13 @@
 #include <stropts.h>
 #include <unistd.h>
 #include "config.h"
+#include "health.h"
 #include "optical_eye_utils.h"
+#include "output.h"
 
 #define MESSAGE_LINE_COUNT 10
 #define DEFAULT_BAUDRATE B300
+#define RESPONSE_TIMEOUT 3000 // Milliseconds.
 
 int main(int argc, char *argv[])
 {
@@ -29,19 +32,37 @@ int main(int argc, char *argv[])
         printf("%s: using baudrate %s\n", argv[0], argv[2]);
     }
     int line_count = 0;
-    int optical_eye_fd = setup_optical_eye(device, baudrate, IS_7E1);
+    int optical_eye_fd = open_optical_eye(argv[0], device, baudrate, IS_7E1);
+    health h;
+    health_init(&h);
     write(optical_eye_fd, "/?!\r\n", 5);
     while (1) {
         char c;
-        int received = read(optical_eye_fd, &c, sizeof(c));
+        int received = 0;
+        if (optical_eye_readable(optical_eye_fd, RESPONSE_TIMEOUT)) {
+            received = read(optical_eye_fd, &c, sizeof(c));
+        }
         if (received == 1) {
-            if (c != '\r' && c != '\n') show_char(c);
+            if (c != '\r' && c != '\n') output_char(c);
         } else {
-            fail("No data received from the meter; exiting");
+            // No data received from the meter: sign on again, backing
+            // off exponentially once the meter seems to be unreachable.
+            health_failure(&h, 1);
+            output_string("[timeout]\n");
+            output_flush();
+            if (h.state == CIRCUIT_OPEN) {
+                usleep(health_probe_delay(&h) * 1000L);
+                health_probe_sent(&h);
+            }
+            line_count = 0;
+            write(optical_eye_fd, "/?!\r\n", 5);
+            continue;
         }
+        health_success(&h);
         ioctl(optical_eye_fd, I_FLUSH, FLUSHW);
         if (c == '\n') {
-            putchar(c);
+            output_string("\n");
+            output_flush();
             if (line_count++ == MESSAGE_LINE_COUNT) break;
         }
     }
@@ -0,0 +1,485 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "config.h"
+#include "optical_eye_utils.h"
+#include "store.h"
+#include "variables.h"
+
+// Ingest the logs written by readallvars, i.e., the output of readvar
+// in files named readallvars-output-YYYYMMDD-HHMM.txt, into a store.
+// The files are mapped and cut into chunks at line boundaries, and the
+// chunks are scanned by a number of threads, each of which appends its
+// records to the store in big blocks.
+//
+// A reading is a line `<name> (id <var_id>): <value>`, with the value
+// rendered as by `show_package`. Numbers with a unit, times, dates, RTC
+// values and integers are stored: a time as the seconds since midnight,
+// a date as the number yymmdd, and an RTC value as the seconds since
+// the epoch, taking the clock of the meter to be local time. Lines
+// without a value, and values which are not numbers (text, raw data),
+// are counted and skipped.
+//
+// All readings of a log are stamped with the time in its name, which
+// is when readallvars was started, or else with the time the log was
+// last modified. Their source is the device named in the log, as in
+// the records written by the collector, or else the default device.
+
+#ifndef INGEST_MAX_WORKERS
+#define INGEST_MAX_WORKERS 16
+#endif
+#ifndef INGEST_CHUNK_LENGTH
+#define INGEST_CHUNK_LENGTH (1 << 20)
+#endif
+#ifndef INGEST_BUFFER_RECORDS
+#define INGEST_BUFFER_RECORDS 4096
+#endif
+
+#define LOG_NAME_PREFIX "readallvars-output-"
+#define USING_DEVICE ": Using device "
+#define DEVICE_NAME_LENGTH 256
+
+// A mapped log. It is unmapped when all of its chunks have been taken
+// and scanned, so each thread keeps at most one log mapped besides the
+// one chunks are being taken from.
+typedef struct _log_file {
+    char const *data;              // NULL: unused.
+    size_t length;
+    size_t next;                   // Where the next chunk starts.
+    int chunks;                    // Taken and not yet scanned.
+    int64_t time;
+    uint32_t source;
+} log_file;
+
+typedef struct _chunk {
+    log_file *file;
+    char const *start, *end;
+} chunk;
+
+typedef enum _line_kind {
+    LINE_READING, LINE_EMPTY, LINE_NOT_NUMERIC, LINE_UNRECOGNISED
+} line_kind;
+
+typedef struct _worker {
+    pthread_t thread;
+    store_record records[INGEST_BUFFER_RECORDS];
+    int count;
+    unsigned long lines[LINE_UNRECOGNISED + 1];
+} worker;
+
+static char **paths;
+static int path_count, next_path = 0;
+static char const *source_name = NULL;
+static log_file files[INGEST_MAX_WORKERS + 1];
+static log_file *current = NULL;   // The log chunks are taken from.
+static int file_count = 0, failed_files = 0;
+static pthread_mutex_t chunk_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t store_lock = PTHREAD_MUTEX_INITIALIZER;
+static int store_fd;
+static worker workers[INGEST_MAX_WORKERS];
+
+void usage(char *self) {
+    printf("Usage: %s [-j workers] [-s device] store log...\n", self);
+    exit(0);
+}
+
+// The first occurrence of `pattern` in the text from `text` to `end`,
+// or NULL.
+static char const *find(char const *text, char const *end,
+                        char const *pattern)
+{
+    int length = strlen(pattern);
+    while (end - text >= length) {
+        text = memchr(text, pattern[0], end - text - length + 1);
+        if (!text) return NULL;
+        if (!memcmp(text, pattern, length)) return text;
+        text++;
+    }
+    return NULL;
+}
+
+static int starts_with(char const *text, char const *end,
+                       char const *pattern)
+{
+    int length = strlen(pattern);
+    return end - text >= length && !memcmp(text, pattern, length);
+}
+
+// Scan a number as printed by "%f", "%d" or "%lu" into `value`, and
+// return where it ends, or NULL if there is none.
+static char const *scan_number(char const *text, char const *end,
+                               double *value)
+{
+    static double const powers[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+        1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18
+    };
+    char const *digits;
+    double whole = 0;
+    unsigned long long fraction = 0;
+    int negative = text < end && *text == '-', fraction_digits = 0;
+    if (negative) text++;
+    digits = text;
+    while (text < end && *text >= '0' && *text <= '9') {
+        whole = 10 * whole + (*text++ - '0');
+    }
+    if (text == digits) return NULL;
+    if (text < end && *text == '.') {
+        text++;
+        while (text < end && *text >= '0' && *text <= '9') {
+            if (fraction_digits < 18) {
+                fraction = 10 * fraction + (*text - '0');
+                fraction_digits++;
+            }
+            text++;
+        }
+    }
+    *value = whole + fraction / powers[fraction_digits];
+    if (negative) *value = -*value;
+    return text;
+}
+
+// The code of the unit named at `text`, up to a ']' or a ", " followed
+// by more details. Some names contain a ',', e.g., "hh,mm,ss".
+static int scan_bracketed_unit(char const *text, char const *end)
+{
+    char const *stop = text;
+    while (stop < end && *stop != ']' &&
+           !(stop[0] == ',' && stop + 1 < end && stop[1] == ' ')) {
+        stop++;
+    }
+    return stop < end ? unit_code_of(text, stop - text) : -1;
+}
+
+static int scan_month(char const *text)
+{
+    int month;
+    for (month = 1; month <= 12; month++) {
+        if (!memcmp(text, month_name[month], 3)) return month;
+    }
+    return -1;
+}
+
+// Scan the value from `text` to `end`, as rendered by `show_package`,
+// into `value` and `unit`.
+static line_kind scan_value(char const *text, char const *end,
+                            double *value, int *unit)
+{
+    char const *next;
+    if (starts_with(text, end, "No value returned.") ||
+        starts_with(text, end, "No response.") ||
+        starts_with(text, end, "Meter not responding")) {
+        return LINE_EMPTY;
+    }
+    if (starts_with(text, end, "\"") || starts_with(text, end, "[") ||
+        starts_with(text, end, "Raw data:") ||
+        find(text, end, " not yet supported, ")) {
+        return LINE_NOT_NUMERIC;
+    }
+    next = scan_number(text, end, value);
+    if (!next) return LINE_UNRECOGNISED;
+    if (end - next >= 2 && next[0] == ' ' && next[1] == '[') {
+        // An integer, "%lu [unit, length %d]".
+        *unit = scan_bracketed_unit(next + 2, end);
+    } else if (end - next >= 2 && next[0] == ' ') {
+        // A number, "%0.4f unit".
+        *unit = unit_code_of(next + 1, end - next - 1);
+    } else if (next - text == 2 && end - next >= 8 &&
+               next[0] == ':' && next[3] == ':') {
+        // A time, "hh:mm:ss [unit", or an RTC value, "hh:mm:ss dd-Mon-yyyy
+        // [unit".
+        struct tm tm;
+        memset(&tm, 0, sizeof(tm));
+        tm.tm_hour = (int)*value;
+        tm.tm_min = store_scan_digits(next + 1, 2);
+        tm.tm_sec = store_scan_digits(next + 4, 2);
+        next += 6;
+        if (tm.tm_min < 0 || tm.tm_sec < 0) return LINE_UNRECOGNISED;
+        if (next[0] == ' ' && next[1] == '[') {
+            *value = 3600 * tm.tm_hour + 60 * tm.tm_min + tm.tm_sec;
+            *unit = scan_bracketed_unit(next + 2, end);
+        } else if (end - next >= 15 && next[0] == ' ' && next[3] == '-' &&
+                   next[7] == '-' && next[12] == ' ' && next[13] == '[') {
+            tm.tm_mday = store_scan_digits(next + 1, 2);
+            tm.tm_mon = scan_month(next + 4) - 1;
+            tm.tm_year = store_scan_digits(next + 8, 4) - 1900;
+            tm.tm_isdst = -1;
+            if (tm.tm_mday < 0 || tm.tm_mon < 0 || tm.tm_year < 0) {
+                return LINE_UNRECOGNISED;
+            }
+            *value = mktime(&tm);
+            *unit = scan_bracketed_unit(next + 14, end);
+        } else {
+            return LINE_UNRECOGNISED;
+        }
+    } else if (next - text == 2 && end - next >= 10 && next[0] == '-' &&
+               next[4] == '-' && next[7] == ' ' && next[8] == '[') {
+        // A date, "yy-Mon-dd [unit".
+        int month = scan_month(next + 1);
+        int day = store_scan_digits(next + 5, 2);
+        if (month < 0 || day < 0) return LINE_UNRECOGNISED;
+        *value = 10000 * *value + 100 * month + day;
+        *unit = scan_bracketed_unit(next + 9, end);
+    } else {
+        return LINE_UNRECOGNISED;
+    }
+    return *unit < 0 ? LINE_UNRECOGNISED : LINE_READING;
+}
+
+static void flush_records(worker *w)
+{
+    int appended;
+    pthread_mutex_lock(&store_lock);
+    appended = store_append(store_fd, w->records, w->count);
+    pthread_mutex_unlock(&store_lock);
+    if (!appended) fail("Could not write to the store");
+    w->count = 0;
+}
+
+static void scan_line(worker *w, log_file const *file,
+                      char const *line, char const *end)
+{
+    char const *text = find(line, end, " (id ");
+    store_record *record;
+    double value;
+    int var_id = 0, unit = -1;
+    line_kind kind;
+    // Other lines, e.g., the device used, are not counted.
+    if (!text) return;
+    if (end > line && end[-1] == '\r') end--;
+    for (text += 5; text < end && *text >= '0' && *text <= '9'; text++) {
+        var_id = 10 * var_id + (*text - '0');
+        if (var_id > 0xffff) return;
+    }
+    if (!starts_with(text, end, "):")) return;
+    text += 2;
+    if (text < end && *text == ' ') text++;
+    kind = scan_value(text, end, &value, &unit);
+    w->lines[kind]++;
+    if (kind != LINE_READING) return;
+    if (w->count == INGEST_BUFFER_RECORDS) flush_records(w);
+    record = w->records + w->count++;
+    record->time = file->time;
+    record->value = value;
+    record->source = file->source;
+    record->window = 0;
+    record->count = 1;
+    record->meter_offset = 0;
+    record->meter_error = -1;
+    record->var_id = var_id;
+    record->kind = STORE_SAMPLE;
+    record->unit = unit;
+}
+
+// The time in the name of a log in nanoseconds since the epoch, or -1.
+static int64_t time_of_name(char const *path)
+{
+    char const *name = strstr(path, LOG_NAME_PREFIX);
+    int64_t time;
+    if (!name) return -1;
+    name += strlen(LOG_NAME_PREFIX);
+    if (strlen(name) < 13 || !store_parse_time(name, 13, &time)) return -1;
+    return time < 0 ? -1 : time;
+}
+
+// The source of the readings in `file`, from the device named before
+// its first reading.
+static uint32_t source_of_log(log_file const *file)
+{
+    char const *line = file->data, *end = file->data + file->length;
+    char device[DEVICE_NAME_LENGTH];
+    if (source_name) return store_source(source_name);
+    while (line < end) {
+        char const *line_end = memchr(line, '\n', end - line);
+        char const *found;
+        if (!line_end) line_end = end;
+        if (find(line, line_end, " (id ")) break;
+        found = find(line, line_end, USING_DEVICE);
+        if (found) {
+            int length;
+            found += strlen(USING_DEVICE);
+            length = line_end - found;
+            if (length > 0 && length < sizeof(device)) {
+                memcpy(device, found, length);
+                device[length] = '\0';
+                return store_source(device);
+            }
+        }
+        line = line_end + 1;
+    }
+    return store_source(DEVICE);
+}
+
+// Map the next log given, reporting and skipping those which cannot be
+// read. Called with `chunk_lock` held.
+static log_file *open_next_file(void)
+{
+    while (next_path < path_count) {
+        char const *path = paths[next_path++];
+        struct stat status;
+        log_file *file;
+        void *data;
+        int fd = open(path, O_RDONLY);
+        if (fd < 0 || fstat(fd, &status) < 0) {
+            perror(path);
+            if (fd >= 0) close(fd);
+            failed_files++;
+            continue;
+        }
+        file_count++;
+        if (status.st_size == 0) {
+            close(fd);
+            continue;
+        }
+        data = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) {
+            perror(path);
+            file_count--;
+            failed_files++;
+            continue;
+        }
+        madvise(data, status.st_size, MADV_SEQUENTIAL);
+        // Logs in use are the current one, and those with a chunk being
+        // scanned by one of the other threads, so one is free.
+        for (file = files; file->data; file++);
+        file->data = data;
+        file->length = status.st_size;
+        file->next = 0;
+        file->chunks = 0;
+        file->time = time_of_name(path);
+        if (file->time < 0) {
+            file->time = status.st_mtim.tv_sec * STORE_SECOND +
+                status.st_mtim.tv_nsec;
+        }
+        file->source = source_of_log(file);
+        return file;
+    }
+    return NULL;
+}
+
+// Take the next chunk, ending at a line boundary. Returns zero when all
+// logs have been taken.
+static int take_chunk(chunk *c)
+{
+    log_file *file;
+    pthread_mutex_lock(&chunk_lock);
+    if (!current) current = open_next_file();
+    file = current;
+    if (file) {
+        size_t end = file->next + INGEST_CHUNK_LENGTH;
+        if (end >= file->length) {
+            end = file->length;
+        } else {
+            char const *newline =
+                memchr(file->data + end, '\n', file->length - end);
+            end = newline ? newline - file->data + 1 : file->length;
+        }
+        c->file = file;
+        c->start = file->data + file->next;
+        c->end = file->data + end;
+        file->next = end;
+        file->chunks++;
+        if (end == file->length) current = NULL;
+    }
+    pthread_mutex_unlock(&chunk_lock);
+    return file != NULL;
+}
+
+static void finish_chunk(chunk const *c)
+{
+    log_file *file = c->file;
+    pthread_mutex_lock(&chunk_lock);
+    if (--file->chunks == 0 && file != current) {
+        munmap((void *)file->data, file->length);
+        file->data = NULL;
+    }
+    pthread_mutex_unlock(&chunk_lock);
+}
+
+static void *ingest_loop(void *argument)
+{
+    worker *w = argument;
+    chunk c;
+    while (take_chunk(&c)) {
+        char const *line = c.start;
+        while (line < c.end) {
+            char const *line_end = memchr(line, '\n', c.end - line);
+            if (!line_end) line_end = c.end;
+            scan_line(w, c.file, line, line_end);
+            line = line_end + 1;
+        }
+        finish_chunk(&c);
+    }
+    if (w->count > 0) flush_records(w);
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long lines[LINE_UNRECOGNISED + 1] = {0};
+    int worker_count = sysconf(_SC_NPROCESSORS_ONLN), option, index, kind;
+    struct timespec start, end;
+
+    while ((option = getopt(argc, argv, "j:s:")) != -1) {
+        switch (option) {
+            case 'j':
+                worker_count = atoi(optarg);
+                if (worker_count < 1 || worker_count > INGEST_MAX_WORKERS) {
+                    usage(argv[0]);
+                }
+                break;
+            case 's':
+                source_name = optarg;
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (argc - optind < 2) usage(argv[0]);
+    if (worker_count < 1) worker_count = 1;
+    if (worker_count > INGEST_MAX_WORKERS) worker_count = INGEST_MAX_WORKERS;
+    store_fd = store_open(argv[optind]);
+    if (store_fd < 0) fail("Could not open the store");
+    paths = argv + optind + 1;
+    path_count = argc - optind - 1;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (index = 0; index < worker_count; index++) {
+        if (pthread_create(&workers[index].thread, NULL, ingest_loop,
+                           workers + index)) {
+            fail("Could not start a worker thread");
+        }
+    }
+    for (index = 0; index < worker_count; index++) {
+        pthread_join(workers[index].thread, NULL);
+        for (kind = 0; kind <= LINE_UNRECOGNISED; kind++) {
+            lines[kind] += workers[index].lines[kind];
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    close(store_fd);
+
+    printf("%s: %lu readings from %d logs in %.2f seconds, %d threads\n",
+           argv[0], lines[LINE_READING], file_count,
+           (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9,
+           worker_count);
+    printf("%s: Skipped %lu without a value, %lu not numeric, "
+           "%lu not recognised\n", argv[0], lines[LINE_EMPTY],
+           lines[LINE_NOT_NUMERIC], lines[LINE_UNRECOGNISED]);
+    if (failed_files > 0) {
+        printf("%s: %d logs could not be read\n", argv[0], failed_files);
+        return 1;
+    }
+    return 0;
+}
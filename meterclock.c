@@ -0,0 +1,122 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "meterclock.h"
+
+#define SECOND 1000000000LL
+
+void meter_clock_init(meter_clock *c)
+{
+    memset(c, 0, sizeof(*c));
+}
+
+// The drift of the meter clock, not accounted for, over `elapsed`.
+static int64_t drift_bound(int64_t elapsed)
+{
+    if (elapsed < 0) elapsed = -elapsed;
+    return elapsed / 1000000 * METER_CLOCK_DRIFT_BOUND;
+}
+
+static clock_reading const *reading(meter_clock const *c, int age)
+{
+    return c->readings +
+        (c->next - 1 - age + 2 * METER_CLOCK_READINGS) % METER_CLOCK_READINGS;
+}
+
+static void estimate_drift(meter_clock *c)
+{
+    clock_reading const *last = reading(c, 0);
+    double sum_x = 0, sum_y = 0, sum_xx = 0, sum_xy = 0, n = c->count;
+    double limit = METER_CLOCK_MAX_DRIFT / 1e6;
+    int age;
+    c->drift = 0;
+    if (c->count < 3 ||
+        last->local - reading(c, c->count - 1)->local < METER_CLOCK_MIN_SPAN) {
+        return;
+    }
+    for (age = 0; age < c->count; age++) {
+        clock_reading const *r = reading(c, age);
+        double x = r->local - last->local;
+        double y = r->low / 2.0 + r->high / 2.0;
+        sum_x += x;
+        sum_y += y;
+        sum_xx += x * x;
+        sum_xy += x * y;
+    }
+    if (n * sum_xx - sum_x * sum_x <= 0) return;
+    c->drift = (n * sum_xy - sum_x * sum_y) / (n * sum_xx - sum_x * sum_x);
+    if (c->drift > limit) c->drift = limit;
+    if (c->drift < -limit) c->drift = -limit;
+}
+
+static void estimate(meter_clock *c)
+{
+    clock_reading const *last = reading(c, 0);
+    int64_t low = INT64_MIN, high = INT64_MAX;
+    int age;
+    estimate_drift(c);
+    for (age = 0; age < c->count; age++) {
+        clock_reading const *r = reading(c, age);
+        int64_t elapsed = last->local - r->local;
+        int64_t shift = (int64_t)(c->drift * elapsed);
+        int64_t slack = drift_bound(elapsed);
+        if (r->low + shift - slack > low) low = r->low + shift - slack;
+        if (r->high + shift + slack < high) high = r->high + shift + slack;
+    }
+    if (low > high) {
+        // The drift is off; the last read still holds.
+        low = last->low;
+        high = last->high;
+    }
+    c->reference = last->local;
+    c->offset = low / 2 + high / 2;
+    c->error = high / 2 - low / 2;
+}
+
+void meter_clock_add(meter_clock *c, int64_t sent, int64_t received,
+                     int64_t meter)
+{
+    clock_reading r;
+    int64_t offset, error;
+    r.local = sent / 2 + received / 2;
+    r.low = meter - received;
+    r.high = meter + SECOND - sent;
+    if (meter_clock_estimate(c, r.local, &offset, &error) &&
+        (r.high < offset - error || r.low > offset + error)) {
+        c->count = 0;
+        c->steps++;
+    }
+    c->readings[c->next] = r;
+    c->next = (c->next + 1) % METER_CLOCK_READINGS;
+    if (c->count < METER_CLOCK_READINGS) c->count++;
+    c->reads++;
+    estimate(c);
+}
+
+int meter_clock_estimate(meter_clock const *c, int64_t local,
+                         int64_t *offset, int64_t *error)
+{
+    int64_t elapsed = local - c->reference;
+    if (c->count == 0) return 0;
+    *offset = c->offset + (int64_t)(c->drift * elapsed);
+    *error = c->error + drift_bound(elapsed);
+    return 1;
+}
+
+int meter_clock_format(char *text, int length, int64_t local,
+                       int64_t offset, int64_t error)
+{
+    int64_t meter = local + offset;
+    time_t seconds = meter / SECOND;
+    char date[32];
+    struct tm tm;
+    if (error < 0) return snprintf(text, length, "meter time unknown");
+    localtime_r(&seconds, &tm);
+    strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", &tm);
+    return snprintf(text, length, "meter %s.%03d +-%.3f s", date,
+                    (int)(meter % SECOND / 1000000), (double)error / SECOND);
+}
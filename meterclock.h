@@ -0,0 +1,71 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#ifndef METERCLOCK_H
+#define METERCLOCK_H
+
+#include <stdint.h>
+
+// An estimate of the clock of a meter relative to CLOCK_REALTIME, from
+// occasional reads of its RTC, so the time of the meter can be given
+// for any exchange without reading the RTC along with it.
+//
+// The RTC shows whole seconds, and its value is taken somewhere between
+// the request and the response, so a read bounds the offset of the
+// meter clock to an interval one second plus the round trip wide, at
+// the middle of the exchange. The drift of the offset is estimated by
+// a least squares fit to the middles of these intervals, once they span
+// METER_CLOCK_MIN_SPAN, and the intervals of the recent reads, moved
+// along the drift to the last read and widened by METER_CLOCK_DRIFT_BOUND
+// for the time moved, are intersected. The offset is the middle of the
+// intersection, and the error bound its half width, growing again by
+// METER_CLOCK_DRIFT_BOUND with the time since the last read.
+//
+// A read outside the estimate means that the clock of the meter has
+// been set, and the estimate starts over from that read.
+
+#ifndef METER_CLOCK_READINGS
+#define METER_CLOCK_READINGS 8
+#endif
+#define METER_CLOCK_MIN_SPAN (6 * 3600 * 1000000000LL)
+#define METER_CLOCK_DRIFT_BOUND 50 // Parts per million, not estimated.
+#define METER_CLOCK_MAX_DRIFT 1000 // Parts per million.
+
+// All times are in nanoseconds, since the epoch unless said otherwise.
+typedef struct _clock_reading {
+    int64_t local;                 // The middle of the exchange.
+    int64_t low, high;             // Bounds on the offset at `local`.
+} clock_reading;
+
+typedef struct _meter_clock {
+    clock_reading readings[METER_CLOCK_READINGS];
+    int count, next;
+    double drift;                  // Of the offset, per unit of time.
+    int64_t reference;             // The time of the last read,
+    int64_t offset, error;         // and the estimate at that time.
+    unsigned long reads;
+    unsigned long steps;           // The clock was found to be set.
+} meter_clock;
+
+void meter_clock_init(meter_clock *c);
+
+// Add a read of the RTC showing `meter`, which was requested at `sent`
+// and received at `received`.
+void meter_clock_add(meter_clock *c, int64_t sent, int64_t received,
+                     int64_t meter);
+
+// Set `offset` to the offset of the meter clock from `local` at `local`,
+// i.e., the time of the meter minus `local`, and `error` to the bound on
+// its error. Returns zero if the clock has not been read.
+int meter_clock_estimate(meter_clock const *c, int64_t local,
+                         int64_t *offset, int64_t *error);
+
+// Write the time of the meter at `local`, given the `offset` of its
+// clock and the bound on its `error` as by `meter_clock_estimate`, into
+// `text`, as "meter 2015-06-01 12:00:00.250 +-0.600 s" in local time,
+// or "meter time unknown" if `error` is negative. Returns as snprintf.
+int meter_clock_format(char *text, int length, int64_t local,
+                       int64_t offset, int64_t error);
+
+#endif
@@ -0,0 +1,103 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+// Generate frame_tables.c: the escaped request frames, with CRC, for
+// every register in `var_data` and for the batches listed below. Run
+// by the Makefile, the output is written to stdout.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "frames.h"
+#include "optical_eye_utils.h"
+#include "variables.h"
+
+typedef struct _batch {
+    char const *name;
+    unsigned short var_ids[BATCH_MAX_REGISTERS + 1]; // Terminated by 0.
+} batch;
+
+// Registers commonly read together. A batch must not contain id 0, as
+// it is used as the terminator.
+static batch batches[] = {
+    {"energy", {1, 2, 3, 4, 0}},
+    {"clock", {1002, 1003, 0}},
+    {"voltage", {1054, 1055, 1056, 0}},
+    {"current", {1076, 1077, 1078, 0}},
+    {"power", {1023, 1080, 1081, 1082, 0}},
+    {"phases", {1054, 1055, 1056, 1076, 1077, 1078, 0}},
+    {NULL, {0}}
+};
+
+static void emit_bytes(unsigned char const *frame, int length)
+{
+    int index;
+    printf("{");
+    for (index = 0; index < length; index++) {
+        printf("%s0x%02x", index ? ", " : "", frame[index]);
+    }
+    printf("}");
+}
+
+static void check_known(int var_id)
+{
+    id2str *var;
+    for (var = var_data; var->description; var++) {
+        if ((int)var->id == var_id) return;
+    }
+    fprintf(stderr, "mkframes: unknown register %d\n", var_id);
+    exit(1);
+}
+
+int main(void)
+{
+    unsigned char request[BATCH_REQUEST_LENGTH(BATCH_MAX_REGISTERS)];
+    unsigned char frame[2 * sizeof(request)];
+    id2str *var;
+    batch *b;
+    int count = 0, previous = -1;
+
+    printf("// Generated by mkframes, do not edit.\n\n");
+    printf("#include \"frames.h\"\n\n");
+
+    printf("request_frame const request_frames[] = {\n");
+    for (var = var_data; var->description; var++) {
+        if ((int)var->id <= previous) {
+            fprintf(stderr, "mkframes: var_data is not sorted at %d\n",
+                    var->id);
+            exit(1);
+        }
+        previous = var->id;
+        int length = build_read_request(request, KMP_DEFAULT_ADDRESS,
+                                        var->id);
+        length = escape_package(request, length, frame);
+        if (length > REQUEST_FRAME_LENGTH) fail("Request frame too long");
+        printf("    {%u, %d, ", var->id, length);
+        emit_bytes(frame, length);
+        printf("},\n");
+        count++;
+    }
+    printf("};\n\n");
+    printf("int const request_frames_length = %d;\n\n", count);
+
+    printf("batch_frame const batch_frames[] = {\n");
+    for (b = batches; b->name; b++) {
+        int index = 0;
+        while (b->var_ids[index]) check_known(b->var_ids[index++]);
+        if (index > BATCH_MAX_REGISTERS) fail("Batch too large");
+        int length = build_batch_request(request, KMP_DEFAULT_ADDRESS,
+                                         b->var_ids, index);
+        length = escape_package(request, length, frame);
+        if (length > BATCH_FRAME_LENGTH) fail("Batch frame too long");
+        printf("    {\"%s\", %d, {", b->name, index);
+        for (count = 0; count < index; count++) {
+            printf("%s%u", count ? ", " : "", b->var_ids[count]);
+        }
+        printf("}, %d, ", length);
+        emit_bytes(frame, length);
+        printf("},\n");
+    }
+    printf("    {0, 0, {0}, 0, {0}}\n");
+    printf("};\n");
+    return 0;
+}
@@ -3,12 +3,22 @@
 // the LICENSE file.
 
 #include <fcntl.h>
+#include <libgen.h>
+#include <limits.h>
+#include <poll.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/ioctl.h>
 #include <termios.h>
+#include <time.h>
 #include <unistd.h>
+#ifdef __linux__
+#include <linux/serial.h>
+#endif
+#include "config.h"
 #include "optical_eye_utils.h"
+#include "output.h"
 
 void fail(char const *msg)
 {
@@ -16,19 +26,16 @@ void fail(char const *msg)
     exit(-1);
 }
 
-int setup_optical_eye(char const *optical_eye_device, 
-                      int optical_eye_baudrate,
-                      int is_7e1)
+char const *configure_optical_eye(int optical_eye_fd,
+                                  int optical_eye_baudrate,
+                                  int is_7e1)
 {
-    int optical_eye_fd = open(optical_eye_device, O_RDWR);
     struct termios  config;
 
-    if (optical_eye_fd < 0)
-        fail("Could not open the optical eye device");
     if (!isatty(optical_eye_fd))
-        fail("Optical eye device is not a TTY");
+        return "Optical eye device is not a TTY";
     if (tcgetattr(optical_eye_fd, &config) < 0)
-        fail("Error getting current configuration of optical eye device");
+        return "Error getting current configuration of optical eye device";
 
     // Specify no input processing.
     config.c_iflag &=
@@ -44,7 +51,7 @@ int setup_optical_eye(char const *optical_eye_device,
     if (is_7e1) {
         // reset existing char size mask, specify even parity,
         // then force 7 bit char size and parity checking.
-        config.c_cflag &= ~(CSIZE | PARODD);
+        config.c_cflag &= ~(CSIZE | PARODD | CSTOPB);
         config.c_cflag |= CS7 | PARENB;
     } else {
         // reset existing char size mask, and disable parity,
@@ -60,95 +67,332 @@ int setup_optical_eye(char const *optical_eye_device,
     // Specify the baud rate.
     if (cfsetispeed(&config, optical_eye_baudrate) < 0 ||
         cfsetospeed(&config, optical_eye_baudrate) < 0) {
-        fail("Could not set the desired baud rate");
+        return "Could not set the desired baud rate";
     }
-    
+
     // Send the configuration to the device.
     if (tcsetattr(optical_eye_fd, TCSAFLUSH, &config) < 0) {
-        fail("Could not apply configuration to optical eye device");
+        return "Could not apply configuration to optical eye device";
     }
+    return NULL;
+}
 
+int setup_optical_eye(char const *optical_eye_device, 
+                      int optical_eye_baudrate,
+                      int is_7e1)
+{
+    int optical_eye_fd = open(optical_eye_device, O_RDWR);
+    char const *error;
+
+    if (optical_eye_fd < 0)
+        fail("Could not open the optical eye device");
+    error = configure_optical_eye(optical_eye_fd, optical_eye_baudrate,
+                                  is_7e1);
+    if (error) fail(error);
     return optical_eye_fd;
 }
 
-static char *hex_char = "0123456789abcdef";
+// The FTDI style USB serial adapters hold back received data for up to
+// `latency_timer` milliseconds, the driver default being 16. This is
+// the smallest value they accept.
+#define MIN_LATENCY_TIMER 1
 
-void show_char(unsigned char c)
+static int set_latency_timer(char const *self, char const *device)
 {
-    char default_output[2] = {' ', '\0'};
-    char hex_output[4] = {'#', ' ', ' ', '\0'};
-    char *output;
-    switch (c) {
-        case '\000': output = "[NUL]"; break;
-        case '\001': output = "[SOH]"; break;
-        case '\002': output = "[STX]"; break;
-        case '\003': output = "[ETX]"; break;
-        case '\004': output = "[EOT]"; break;
-        case '\005': output = "[ENQ]"; break;
-        case '\006': output = "[ACK]"; break;
-        case '\007': output = "[BEL]"; break;
-        case '\010': output =  "[BS]"; break;
-        case '\011': output = "[TAB]"; break;
-        case '\012': output =  "[LF]"; break;
-        case '\013': output =  "[VT]"; break;
-        case '\014': output =  "[FF]"; break;
-        case '\015': output =  "[CR]"; break;
-        case '\016': output =  "[SO]"; break;
-        case '\017': output =  "[SI]"; break;
-        case '\020': output = "[DLE]"; break;
-        case '\021': output = "[DC1]"; break;
-        case '\022': output = "[DC2]"; break;
-        case '\023': output = "[DC3]"; break;
-        case '\024': output = "[DC4]"; break;
-        case '\025': output = "[NAK]"; break;
-        case '\026': output = "[SYN]"; break;
-        case '\027': output = "[ETB]"; break;
-        case '\030': output = "[CAN]"; break;
-        case '\031': output =  "[EM]"; break;
-        case '\032': output = "[SUB]"; break;
-        case '\033': output = "[ESC]"; break;
-        case '\034': output =  "[FS]"; break;
-        case '\035': output =  "[GS]"; break;
-        case '\036': output =  "[RS]"; break;
-        case '\037': output =  "[US]"; break;
-        case '\x7F': output = "[DEL]"; break;
-        default:
-            if (c >= ' ' && c <= '\x7f') {
-                default_output[0] = c;
-                output = default_output;
-            } else {
-                int byte = (unsigned char)c;
-                hex_output[1] = hex_char[byte >> 4];
-                hex_output[2] = hex_char[byte & '\x0f'];
-                output = hex_output;
-            }
+    char resolved[PATH_MAX], path[PATH_MAX];
+    FILE *latency_timer;
+    int old_value = 0, written = 0;
+    if (!realpath(device, resolved)) return 0;
+    snprintf(path, sizeof(path), "/sys/class/tty/%s/device/latency_timer",
+             basename(resolved));
+    latency_timer = fopen(path, "r+");
+    if (!latency_timer) {
+        fprintf(stderr, "%s: low latency: no latency timer for %s\n",
+                self, device);
+        return 0;
+    }
+    if (fscanf(latency_timer, "%d", &old_value) != 1) {
+        fclose(latency_timer);
+        fprintf(stderr, "%s: low latency: could not read latency timer\n",
+                self);
+        return 0;
+    }
+    if (old_value > MIN_LATENCY_TIMER) {
+        rewind(latency_timer);
+        written = fprintf(latency_timer, "%d\n", MIN_LATENCY_TIMER) > 0;
     }
-    printf("%s", output);
+    if (fclose(latency_timer) != 0 ||
+        (old_value > MIN_LATENCY_TIMER && !written)) {
+        fprintf(stderr, "%s: low latency: could not set latency timer\n",
+                self);
+        return 0;
+    }
+    if (written) {
+        fprintf(stderr, "%s: low latency: latency timer %d ms -> %d ms\n",
+                self, old_value, MIN_LATENCY_TIMER);
+    } else {
+        fprintf(stderr, "%s: low latency: latency timer already %d ms\n",
+                self, old_value);
+    }
+    return 1;
 }
 
-static char *baudrate_names[] = {
-    "50", "75", "110", "134", "150", "200", "300", "600",
-    "1200", "1800", "2400", "4800", "9600", "19200", "38400",
-    NULL
-};
+int optical_eye_low_latency(char const *self, int optical_eye_fd,
+                            char const *optical_eye_device)
+{
+    int applied = 0;
+    struct termios config;
+
+#if defined(__linux__) && defined(TIOCGSERIAL)
+    struct serial_struct serial;
+    if (ioctl(optical_eye_fd, TIOCGSERIAL, &serial) < 0) {
+        // Typically a pty, or an adapter without serial_struct support.
+        fprintf(stderr, "%s: low latency: ASYNC_LOW_LATENCY not supported\n",
+                self);
+    } else {
+        serial.flags |= ASYNC_LOW_LATENCY;
+        if (ioctl(optical_eye_fd, TIOCSSERIAL, &serial) < 0) {
+            fprintf(stderr, "%s: low latency: could not set "
+                    "ASYNC_LOW_LATENCY\n", self);
+        } else {
+            fprintf(stderr, "%s: low latency: ASYNC_LOW_LATENCY set\n", self);
+            applied |= LOW_LATENCY_SERIAL;
+        }
+    }
+#else
+    fprintf(stderr, "%s: low latency: ASYNC_LOW_LATENCY not available\n",
+            self);
+#endif
+
+    if (set_latency_timer(self, optical_eye_device)) {
+        applied |= LOW_LATENCY_TIMER;
+    }
 
-static int baudrate_values[] = {
-    B50, B75, B110, B134, B150, B200, B300, B600,
-    B1200, B1800, B2400, B4800, B9600, B19200, B38400
+    // Callers wait for data with poll and then read everything which has
+    // arrived, normally a complete frame, so reads never need to wait in
+    // the driver. A frame sized VMIN would stall on short responses.
+    if (tcgetattr(optical_eye_fd, &config) < 0) {
+        fprintf(stderr, "%s: low latency: could not get VMIN/VTIME\n", self);
+    } else {
+        config.c_cc[VMIN]  = 0;
+        config.c_cc[VTIME] = 0;
+        if (tcsetattr(optical_eye_fd, TCSANOW, &config) < 0) {
+            fprintf(stderr, "%s: low latency: could not set VMIN/VTIME\n",
+                    self);
+        } else {
+            fprintf(stderr, "%s: low latency: VMIN 0, VTIME 0\n", self);
+            applied |= LOW_LATENCY_FRAMES;
+        }
+    }
+    return applied;
+}
+
+void show_char(unsigned char c)
+{
+    output_char(c);
+}
+
+typedef struct _baudrate_entry {
+    char const *name;
+    int value;
+} baudrate_entry;
+
+// Known baud rates, slowest first. The higher rates are included where
+// termios defines them.
+static baudrate_entry baudrates[] = {
+    {"50", B50}, {"75", B75}, {"110", B110}, {"134", B134}, {"150", B150},
+    {"200", B200}, {"300", B300}, {"600", B600}, {"1200", B1200},
+    {"1800", B1800}, {"2400", B2400}, {"4800", B4800}, {"9600", B9600},
+    {"19200", B19200}, {"38400", B38400},
+#ifdef B57600
+    {"57600", B57600},
+#endif
+#ifdef B115200
+    {"115200", B115200},
+#endif
+#ifdef B230400
+    {"230400", B230400},
+#endif
+#ifdef B460800
+    {"460800", B460800},
+#endif
+#ifdef B500000
+    {"500000", B500000},
+#endif
+#ifdef B576000
+    {"576000", B576000},
+#endif
+#ifdef B921600
+    {"921600", B921600},
+#endif
+#ifdef B1000000
+    {"1000000", B1000000},
+#endif
+    {NULL, 0}
 };
 
 int baudrate_of(char *self, char *arg) {
-    int index = 0;
-    while (baudrate_names[index]) {
-        if (!strcmp(baudrate_names[index], arg)) {
-            return baudrate_values[index];
-        }
-        index++;
+    baudrate_entry *entry;
+    if (!strcmp(arg, "auto")) return BAUDRATE_AUTO;
+    for (entry = baudrates; entry->name; entry++) {
+        if (!strcmp(entry->name, arg)) return entry->value;
     }
     fprintf(stderr, "%s: Unknown baudrate '%s', exiting.\n", self, arg);
     exit(-1);
 }
 
+static char const *baudrate_name(int baudrate)
+{
+    baudrate_entry *entry;
+    for (entry = baudrates; entry->name; entry++) {
+        if (entry->value == baudrate) return entry->name;
+    }
+    return "unknown";
+}
+
+// Slowest rate tried during detection; IEC 1107 meters start at 300.
+#define SLOWEST_DETECTED_BAUDRATE B300
+
+// The KMP heartbeat frame used as the probe for 8N2 links, and the
+// IEC 1107 sign-on message used for 7E1 links.
+static unsigned char kmp_probe[] = {
+    '\x80', '\x3f', '\x10', '\x01', '\x04',
+    '\x1b', '\xf9', '\xe9', '\x82', '\x0d'
+};
+static char iec1107_probe[] = "/?!\r\n";
+
+// Send a probe with the current settings, and check that an intact
+// response is received within a time suitable for `bits_per_second`.
+static int probe_optical_eye(int fd, int is_7e1, int bits_per_second)
+{
+    unsigned char buffer[PROBE_BUFFER_LENGTH];
+    int timeout = 200 + 11 * 40 * 1000 / bits_per_second;
+    int length;
+    tcflush(fd, TCIOFLUSH);
+    if (is_7e1) {
+        struct timespec start;
+        write(fd, iec1107_probe, sizeof(iec1107_probe) - 1);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        // Expect an identification line, "/XXXZ<ident>\r\n".
+        length = 0;
+        while (length < PROBE_BUFFER_LENGTH &&
+               optical_eye_readable(fd,
+                                    timeout - milliseconds_since(&start))) {
+            int received = read(fd, buffer + length,
+                                PROBE_BUFFER_LENGTH - length);
+            if (received <= 0) break;
+            length += received;
+            unsigned char *sign_on = memchr(buffer, '/', length);
+            if (sign_on && memchr(sign_on, '\n', buffer + length - sign_on)) {
+                return buffer + length - sign_on > 6;
+            }
+        }
+        return 0;
+    }
+    write(fd, kmp_probe, sizeof(kmp_probe));
+    length = optical_eye_read_package(fd, buffer, PROBE_BUFFER_LENGTH,
+                                      timeout);
+    if (length < 6 || buffer[length - 1] != '\r') return 0;
+    length = descape_package(buffer, length);
+    return length >= 6 && buffer[1] == 0x3f &&
+        crc16(buffer + 1, length - 4) ==
+        ((buffer[length - 3] << 8) | buffer[length - 2]);
+}
+
+// Look up the baudrate cached for `device` with the framing `is_7e1`.
+// Returns nonzero if found.
+static int cached_baudrate(char const *device, int is_7e1, int *baudrate)
+{
+    char line[PATH_MAX + 64], path[PATH_MAX], rate[16];
+    int framing, found = 0;
+    FILE *cache = fopen(BAUDRATE_CACHE, "r");
+    if (!cache) return 0;
+    while (!found && fgets(line, sizeof(line), cache)) {
+        if (sscanf(line, "%s %15s %d", path, rate, &framing) == 3 &&
+            !strcmp(path, device) && framing == is_7e1) {
+            baudrate_entry *entry;
+            for (entry = baudrates; entry->name; entry++) {
+                if (!strcmp(entry->name, rate)) {
+                    *baudrate = entry->value;
+                    found = 1;
+                }
+            }
+        }
+    }
+    fclose(cache);
+    return found;
+}
+
+static void cache_baudrate(char const *device, int is_7e1, int baudrate)
+{
+    char line[PATH_MAX + 64], path[PATH_MAX], temporary[PATH_MAX];
+    FILE *cache = fopen(BAUDRATE_CACHE, "r"), *updated;
+    int framing;
+    snprintf(temporary, sizeof(temporary), "%s.%d", BAUDRATE_CACHE,
+             (int)getpid());
+    updated = fopen(temporary, "w");
+    if (!updated) {
+        if (cache) fclose(cache);
+        return;
+    }
+    while (cache && fgets(line, sizeof(line), cache)) {
+        if (sscanf(line, "%s %*s %d", path, &framing) != 2 ||
+            strcmp(path, device) || framing != is_7e1) {
+            fputs(line, updated);
+        }
+    }
+    if (cache) fclose(cache);
+    fprintf(updated, "%s %s %d\n", device, baudrate_name(baudrate), is_7e1);
+    if (fclose(updated) != 0 || rename(temporary, BAUDRATE_CACHE) < 0) {
+        unlink(temporary);
+    }
+}
+
+static int try_settings(char const *self, int fd, int baudrate, int is_7e1)
+{
+    int bits_per_second = atoi(baudrate_name(baudrate));
+    if (configure_optical_eye(fd, baudrate, is_7e1)) return 0;
+    if (!probe_optical_eye(fd, is_7e1, bits_per_second)) return 0;
+    fprintf(stderr, "%s: Detected baudrate %s, %s\n", self,
+            baudrate_name(baudrate), is_7e1 ? "7E1" : "8N2");
+    return 1;
+}
+
+int detect_optical_eye(char const *self, char const *optical_eye_device,
+                       int is_7e1)
+{
+    int optical_eye_fd = open(optical_eye_device, O_RDWR);
+    int baudrate, index = sizeof(baudrates) / sizeof(baudrates[0]) - 2;
+    if (optical_eye_fd < 0)
+        fail("Could not open the optical eye device");
+    if (cached_baudrate(optical_eye_device, is_7e1, &baudrate) &&
+        try_settings(self, optical_eye_fd, baudrate, is_7e1)) {
+        return optical_eye_fd;
+    }
+    // The fastest rates first.
+    for (; index >= 0; index--) {
+        if (try_settings(self, optical_eye_fd, baudrates[index].value,
+                         is_7e1)) {
+            cache_baudrate(optical_eye_device, is_7e1,
+                           baudrates[index].value);
+            return optical_eye_fd;
+        }
+        if (baudrates[index].value == SLOWEST_DETECTED_BAUDRATE) break;
+    }
+    fprintf(stderr, "%s: Could not detect the baudrate of %s (%s), "
+            "exiting.\n", self, optical_eye_device, is_7e1 ? "7E1" : "8N2");
+    exit(-1);
+}
+
+int open_optical_eye(char const *self, char const *optical_eye_device,
+                     int optical_eye_baudrate, int is_7e1)
+{
+    if (optical_eye_baudrate == BAUDRATE_AUTO) {
+        return detect_optical_eye(self, optical_eye_device, is_7e1);
+    }
+    return setup_optical_eye(optical_eye_device, optical_eye_baudrate, is_7e1);
+}
+
 // The Kamstrup 382Lx7 uses the "XMODEM" crc.
 unsigned short crc16(unsigned char* data_p, unsigned char length)
 {
@@ -164,46 +408,166 @@ unsigned short crc16(unsigned char* data_p, unsigned char length)
     return crc;
 }
 
-void optical_eye_write(int fd, unsigned char *request, int request_length)
+// Bulk scanning kernels used when escaping and de-escaping packages.
+// Escapes are rare in practice, so we look for the next byte which needs
+// attention a vector at a time and copy the bytes in between in bulk.
+// SCAN_SCALAR selects the byte-at-a-time fallback on any target.
+
+#define ESCAPE_CHAR 0x1b
+
+#if defined(SCAN_SCALAR)
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define SCAN_WIDTH 32
+typedef __m256i scan_vector;
+#define scan_load(p) _mm256_loadu_si256((scan_vector const *)(p))
+#define scan_splat(c) _mm256_set1_epi8((char)(c))
+#define scan_eq(a, b) _mm256_cmpeq_epi8(a, b)
+#define scan_or(a, b) _mm256_or_si256(a, b)
+#define scan_mask(v) ((unsigned int)_mm256_movemask_epi8(v))
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SCAN_WIDTH 16
+typedef __m128i scan_vector;
+#define scan_load(p) _mm_loadu_si128((scan_vector const *)(p))
+#define scan_splat(c) _mm_set1_epi8((char)(c))
+#define scan_eq(a, b) _mm_cmpeq_epi8(a, b)
+#define scan_or(a, b) _mm_or_si128(a, b)
+#define scan_mask(v) ((unsigned int)_mm_movemask_epi8(v))
+#endif
+
+static int is_special(unsigned char c)
 {
-    unsigned char *pc = request;
-    int chars_written = 1;
-    write(fd, request, 1); // Start request mark.
-    while (chars_written < request_length - 1) {
-        switch (request[chars_written]) {
-            case 0x06: write(fd, "\x1b\xf9", 2); break;
-            case 0x0d: write(fd, "\x1b\xf2", 2); break;
-            case 0x1b: write(fd, "\x1b\xe4", 2); break;
-            case 0x40: write(fd, "\x1b\xbf", 2); break;
-            case 0x80: write(fd, "\x1b\x7f", 2); break;
-            default: write(fd, request + chars_written, 1);
+    return c == 0x06 || c == 0x0d || c == ESCAPE_CHAR ||
+        c == 0x40 || c == 0x80;
+}
+
+int find_escape(unsigned char const *data, int length)
+{
+    int index = 0;
+#ifdef SCAN_WIDTH
+    scan_vector escape = scan_splat(ESCAPE_CHAR);
+    for (; index + SCAN_WIDTH <= length; index += SCAN_WIDTH) {
+        unsigned int mask =
+            scan_mask(scan_eq(scan_load(data + index), escape));
+        if (mask) return index + __builtin_ctz(mask);
+    }
+#endif
+    for (; index < length; index++) {
+        if (data[index] == ESCAPE_CHAR) break;
+    }
+    return index;
+}
+
+int find_special(unsigned char const *data, int length)
+{
+    int index = 0;
+#ifdef SCAN_WIDTH
+    scan_vector ack = scan_splat(0x06), cr = scan_splat(0x0d),
+        escape = scan_splat(ESCAPE_CHAR), response = scan_splat(0x40),
+        request = scan_splat(0x80);
+    for (; index + SCAN_WIDTH <= length; index += SCAN_WIDTH) {
+        scan_vector v = scan_load(data + index);
+        scan_vector hits = scan_or(scan_or(scan_eq(v, ack), scan_eq(v, cr)),
+                                   scan_or(scan_eq(v, escape),
+                                           scan_or(scan_eq(v, response),
+                                                   scan_eq(v, request))));
+        unsigned int mask = scan_mask(hits);
+        if (mask) return index + __builtin_ctz(mask);
+    }
+#endif
+    for (; index < length; index++) {
+        if (is_special(data[index])) break;
+    }
+    return index;
+}
+
+int escape_package(unsigned char const *request, int request_length,
+                   unsigned char *frame)
+{
+    int index = 1, frame_length = 1;
+    frame[0] = request[0]; // Start request mark.
+    while (index < request_length - 1) {
+        int next = index + find_special(request + index,
+                                        request_length - 1 - index);
+        memcpy(frame + frame_length, request + index, next - index);
+        frame_length += next - index;
+        index = next;
+        if (index < request_length - 1) {
+            frame[frame_length++] = ESCAPE_CHAR;
+            frame[frame_length++] = request[index++] ^ 0xff;
         }
-        pc++;
-        chars_written++;
     }
-    write(fd, request + (request_length - 1), 1); // End request mark.
+    frame[frame_length++] = request[request_length - 1]; // End request mark.
+    return frame_length;
+}
+
+void optical_eye_write(int fd, unsigned char *request, int request_length)
+{
+    unsigned char frame[2 * REQUEST_BUFFER_LENGTH];
+    if (request_length > REQUEST_BUFFER_LENGTH) fail("Request too long");
+    write(fd, frame, escape_package(request, request_length, frame));
 }
 
 int descape_package(unsigned char *buffer, int length) {
-    int index, offset = 0;
-    for (index = 0; index < length; index++) {
-        if (buffer[index] == 0x1b) {
+    int index = 0, offset = 0;
+    while (index < length) {
+        int next = index + find_escape(buffer + index, length - index);
+        if (offset > 0) {
+            memmove(buffer + index - offset, buffer + index, next - index);
+        }
+        index = next;
+        if (index < length) {
+            // All escapes are the escaped byte xor 0xff; a wrong escape
+            // is "descaped" in the same way for now.
             index++; offset++;
-            switch (buffer[index]) {
-                case 0xf9:
-                case 0xf2:
-                case 0xe4:
-                case 0xbf:
-                case 0x7f:
-                    buffer[index - offset] = buffer[index] ^ '\xff';
-                    break;
-                default:
-                    // Wrong escape?! We will "descape it" for now.
-                    buffer[index - offset] = buffer[index] ^ '\xff';
-            }
-        } else {
-            if (offset > 0) buffer[index - offset] = buffer[index];
+            buffer[index - offset] = buffer[index] ^ '\xff';
+            index++;
         }
     }
     return length - offset;
 }
+
+int milliseconds_since(struct timespec const *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000 +
+        (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+int optical_eye_readable(int fd, int timeout)
+{
+    struct pollfd optical_eye_poll;
+    optical_eye_poll.fd = fd;
+    optical_eye_poll.events = POLLIN;
+    return poll(&optical_eye_poll, 1, timeout > 0 ? timeout : 0) > 0;
+}
+
+int optical_eye_read_package(int fd, unsigned char *buffer, int buffer_length,
+                             int timeout)
+{
+    struct timespec start;
+    int received_total = 0, started = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (received_total < buffer_length &&
+           optical_eye_readable(fd, timeout - milliseconds_since(&start))) {
+        int received = read(fd, buffer + received_total,
+                            buffer_length - received_total);
+        unsigned char *end;
+        if (received <= 0) break;
+        if (!started) {
+            // We may need to skip an echo first, so we wait for the
+            // response package start byte 0x40.
+            unsigned char *mark = memchr(buffer, 0x40, received);
+            if (!mark) continue;
+            received -= mark - buffer;
+            memmove(buffer, mark, received);
+            started = 1;
+        }
+        end = memchr(buffer + received_total, '\r', received);
+        if (end) return end - buffer + 1;
+        received_total += received;
+    }
+    return received_total;
+}
@@ -2,24 +2,104 @@
 // source code is governed by a BSD-style license that can be found in
 // the LICENSE file.
 
+#include <time.h>
+
 #define IS_7E1 1
 #define IS_8N2 0
 
-#define BUFFER_LENGTH 8192
+// Buffer lengths per type of frame, in bytes. The defaults hold the
+// largest frames which can occur, and each of them can be set with -D,
+// see PROFILE=small in the Makefile.
+#ifndef REQUEST_BUFFER_LENGTH
+#define REQUEST_BUFFER_LENGTH 64   // Unescaped KMP request.
+#endif
+#ifndef RESPONSE_BUFFER_LENGTH
+#define RESPONSE_BUFFER_LENGTH 544 // Escaped response for one register.
+#endif
+#ifndef BATCH_BUFFER_LENGTH
+#define BATCH_BUFFER_LENGTH 4352   // Escaped response for a batch.
+#endif
+#ifndef PROBE_BUFFER_LENGTH
+#define PROBE_BUFFER_LENGTH 256    // Response to a baudrate probe.
+#endif
 
 void fail(char const *msg);
 
+// Pseudo baudrate, returned by `baudrate_of` for "auto".
+#define BAUDRATE_AUTO -1
+
+// Configure an open optical eye device. Returns NULL on success, and
+// otherwise a description of the failure.
+char const *configure_optical_eye(int optical_eye_fd,
+                                  int optical_eye_baudrate,
+                                  int is_7e1);
+
 int setup_optical_eye(char const *optical_eye_device, 
                       int optical_eye_baudrate,
                       int is_7e1);
 
+// Settings applied by `optical_eye_low_latency`.
+#define LOW_LATENCY_SERIAL 1 // ASYNC_LOW_LATENCY set on the serial port.
+#define LOW_LATENCY_TIMER 2  // USB adapter latency timer lowered.
+#define LOW_LATENCY_FRAMES 4 // VMIN/VTIME set for non-blocking reads.
+
+// Opt-in low-latency configuration of an already set up optical eye:
+// the driver and USB adapter are asked not to hold back received data,
+// and reads return whatever has arrived without waiting, so callers
+// must wait using `optical_eye_readable`. Each setting is reported on
+// stderr, and those which cannot be applied, e.g., on a pty, are
+// skipped. Returns the settings applied.
+int optical_eye_low_latency(char const *self, int optical_eye_fd,
+                            char const *optical_eye_device);
+
 void show_char(unsigned char c);
 
 int baudrate_of(char *self, char *arg);
 
+// Open the optical eye device and find a working baudrate with the
+// framing `is_7e1`, trying the baudrate cached for the device and
+// framing first, then the fastest rates first. The probe is the KMP
+// heartbeat frame for 8N2, and the IEC 1107 sign-on message for 7E1.
+// A working baudrate is cached per device and framing in BAUDRATE_CACHE,
+// so the KMP tools and iec1107 never reuse each other's settings.
+int detect_optical_eye(char const *self, char const *optical_eye_device,
+                       int is_7e1);
+
+// Set up the optical eye, detecting the baudrate if it is BAUDRATE_AUTO.
+int open_optical_eye(char const *self, char const *optical_eye_device,
+                     int optical_eye_baudrate, int is_7e1);
+
 unsigned short crc16(unsigned char* data_p, unsigned char length);
 
+// Escape the bytes between the start and end marks of `request` into
+// `frame`, which must have room for `2 * request_length` bytes. Returns
+// the length of the frame.
+int escape_package(unsigned char const *request, int request_length,
+                   unsigned char *frame);
+
 void optical_eye_write(int fd, unsigned char *request, int request_length);
 
 int descape_package(unsigned char *buffer, int length);
 
+// Return the index of the first escape character in `data`, or `length`.
+int find_escape(unsigned char const *data, int length);
+
+// Return the index of the first byte in `data` which must be escaped
+// when sent to the meter, or `length`.
+int find_special(unsigned char const *data, int length);
+
+
+// Milliseconds elapsed since `start`, on the monotonic clock.
+int milliseconds_since(struct timespec const *start);
+
+// Wait at most `timeout` milliseconds for `fd` to become readable.
+// Returns nonzero if it did.
+int optical_eye_readable(int fd, int timeout);
+
+// Read a response package into `buffer`, skipping any echo of the
+// request before the start byte 0x40, and stopping after the end byte
+// '\r'. Returns the number of bytes received; if the complete package
+// did not arrive within `timeout` milliseconds, the result does not
+// end in '\r'.
+int optical_eye_read_package(int fd, unsigned char *buffer, int buffer_length,
+                             int timeout);
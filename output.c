@@ -0,0 +1,159 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "output.h"
+
+// The buffer is per thread, such that threads can format their output
+// concurrently, each flushing after complete records.
+static __thread char output_buffer[OUTPUT_BUFFER_LENGTH];
+static __thread int output_length = 0;
+static output_hook output_destination = NULL;
+
+// The rendering of every byte value, e.g., "[NUL]", "A" or "#e9", and
+// the rendering of every byte value as " %02x".
+static char rendering[256][6];
+static unsigned char rendering_length[256];
+static char hex_rendering[256][3];
+
+static char const *control_names[] = {
+    "[NUL]", "[SOH]", "[STX]", "[ETX]", "[EOT]", "[ENQ]", "[ACK]", "[BEL]",
+    "[BS]",  "[TAB]", "[LF]",  "[VT]",  "[FF]",  "[CR]",  "[SO]",  "[SI]",
+    "[DLE]", "[DC1]", "[DC2]", "[DC3]", "[DC4]", "[NAK]", "[SYN]", "[ETB]",
+    "[CAN]", "[EM]",  "[SUB]", "[ESC]", "[FS]",  "[GS]",  "[RS]",  "[US]"
+};
+
+static char const *hex_char = "0123456789abcdef";
+
+// Run before main, so the tables are complete before any thread exists.
+// The flush at exit is registered here, once, and runs in the thread
+// calling `exit`.
+__attribute__((constructor)) static void initialize_tables(void)
+{
+    int c;
+    atexit(output_flush);
+    for (c = 0; c < 256; c++) {
+        if (c < ' ') {
+            strcpy(rendering[c], control_names[c]);
+        } else if (c == 0x7f) {
+            strcpy(rendering[c], "[DEL]");
+        } else if (c < 0x7f) {
+            rendering[c][0] = c;
+        } else {
+            rendering[c][0] = '#';
+            rendering[c][1] = hex_char[c >> 4];
+            rendering[c][2] = hex_char[c & 0x0f];
+        }
+        rendering_length[c] = strlen(rendering[c]);
+        hex_rendering[c][0] = ' ';
+        hex_rendering[c][1] = hex_char[c >> 4];
+        hex_rendering[c][2] = hex_char[c & 0x0f];
+    }
+}
+
+static void flush_as(int sample)
+{
+    int written = 0;
+    fflush(stdout);
+    if (output_destination) {
+        if (output_length > 0) {
+            output_destination(output_buffer, output_length, sample);
+        }
+        output_length = 0;
+        return;
+    }
+    while (written < output_length) {
+        int result = write(1, output_buffer + written,
+                           output_length - written);
+        if (result <= 0) break;
+        written += result;
+    }
+    output_length = 0;
+}
+
+void output_flush(void)
+{
+    flush_as(0);
+}
+
+void output_flush_sample(void)
+{
+    flush_as(1);
+}
+
+void output_redirect(output_hook hook)
+{
+    output_flush();
+    output_destination = hook;
+}
+
+// Make room for `length` more bytes in the buffer.
+static void output_reserve(int length)
+{
+    if (output_length + length > OUTPUT_BUFFER_LENGTH) output_flush();
+}
+
+void output_bytes(void const *buffer, int length)
+{
+    if (length > OUTPUT_BUFFER_LENGTH) {
+        output_flush();
+        if (output_destination) {
+            output_destination(buffer, length, 0);
+        } else {
+            write(1, buffer, length);
+        }
+        return;
+    }
+    output_reserve(length);
+    memcpy(output_buffer + output_length, buffer, length);
+    output_length += length;
+}
+
+void output_string(char const *text)
+{
+    output_bytes(text, strlen(text));
+}
+
+void output_char(unsigned char c)
+{
+    output_reserve(sizeof(rendering[c]));
+    memcpy(output_buffer + output_length, rendering[c], sizeof(rendering[c]));
+    output_length += rendering_length[c];
+}
+
+void output_hex(unsigned char const *buffer, int length)
+{
+    int index;
+    for (index = 0; index < length; index++) {
+        output_reserve(3);
+        memcpy(output_buffer + output_length, hex_rendering[buffer[index]], 3);
+        output_length += 3;
+    }
+}
+
+void output_format(char const *format, ...)
+{
+    va_list arguments;
+    int length;
+    output_reserve(256);
+    va_start(arguments, format);
+    length = vsnprintf(output_buffer + output_length,
+                       OUTPUT_BUFFER_LENGTH - output_length,
+                       format, arguments);
+    va_end(arguments);
+    if (length >= OUTPUT_BUFFER_LENGTH - output_length) {
+        // Did not fit: flush and format again into the empty buffer.
+        output_flush();
+        va_start(arguments, format);
+        length = vsnprintf(output_buffer, OUTPUT_BUFFER_LENGTH, format,
+                           arguments);
+        va_end(arguments);
+        if (length >= OUTPUT_BUFFER_LENGTH) length = OUTPUT_BUFFER_LENGTH - 1;
+    }
+    if (length > 0) output_length += length;
+}
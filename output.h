@@ -0,0 +1,42 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+// Buffered output to stdout: text is formatted into a large buffer
+// which is written out in big chunks when it fills up, when it is
+// flushed explicitly, and at exit. Characters received from the meter
+// are rendered using lookup tables. Text written using stdio before
+// the buffered output is flushed first, so the two can be mixed as long
+// as stdio is not used between the output calls and the next flush.
+// Each thread has its own buffer; only the buffer of the thread calling
+// `exit` is flushed at exit, so other threads must flush their own
+// buffers before the program exits.
+
+#ifndef OUTPUT_BUFFER_LENGTH
+#define OUTPUT_BUFFER_LENGTH 65536
+#endif
+
+// Append `c` rendered as printable text, e.g., "[CR]" or "#e9".
+void output_char(unsigned char c);
+
+// Append the bytes in `buffer`, each rendered as " %02x".
+void output_hex(unsigned char const *buffer, int length);
+
+// Append the bytes in `buffer` unchanged.
+void output_bytes(void const *buffer, int length);
+
+void output_string(char const *text);
+
+void output_format(char const *format, ...)
+    __attribute__((format(printf, 1, 2)));
+
+void output_flush(void);
+
+// As `output_flush`, for output which only shows samples, and which may
+// therefore be dropped when the output cannot keep up, see sink.h.
+void output_flush_sample(void);
+
+// Pass flushed output to `hook` instead of writing it to stdout. The
+// output is flushed first.
+typedef void (*output_hook)(void const *buffer, int length, int sample);
+void output_redirect(output_hook hook);
@@ -0,0 +1,92 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include "optical_eye_utils.h"
+#include "pacing.h"
+
+void pacing_init(pacing *p)
+{
+    memset(p, 0, sizeof(*p));
+    p->gap = PACING_INITIAL_GAP;
+}
+
+// The 95th percentile of the recorded turnaround times.
+static int turnaround_percentile(pacing const *p)
+{
+    int sorted[PACING_SAMPLES];
+    int index, count = p->sample_count;
+    for (index = 0; index < count; index++) {
+        int sample = p->samples[index], position = index;
+        while (position > 0 && sorted[position - 1] > sample) {
+            sorted[position] = sorted[position - 1];
+            position--;
+        }
+        sorted[position] = sample;
+    }
+    return sorted[(count * 95) / 100];
+}
+
+int pacing_timeout(pacing const *p)
+{
+    int timeout;
+    if (p->sample_count == 0) return PACING_INITIAL_TIMEOUT;
+    timeout = turnaround_percentile(p) * 3 / 2 + PACING_TIMEOUT_MARGIN;
+    // Back off exponentially while exchanges keep failing.
+    timeout <<= p->failures < 5 ? p->failures : 5;
+    if (timeout < PACING_MIN_TIMEOUT) timeout = PACING_MIN_TIMEOUT;
+    if (timeout > PACING_MAX_TIMEOUT) timeout = PACING_MAX_TIMEOUT;
+    return timeout;
+}
+
+int pacing_delay(pacing const *p)
+{
+    int remaining;
+    if (p->last_exchange.tv_sec == 0 && p->last_exchange.tv_nsec == 0) {
+        return 0;
+    }
+    remaining = p->gap - milliseconds_since(&p->last_exchange);
+    return remaining > 0 ? remaining : 0;
+}
+
+void pacing_wait(pacing *p)
+{
+    int remaining = pacing_delay(p);
+    if (remaining > 0) {
+        struct timespec delay;
+        delay.tv_sec = remaining / 1000;
+        delay.tv_nsec = (remaining % 1000) * 1000000L;
+        while (nanosleep(&delay, &delay) < 0 && errno == EINTR);
+    }
+}
+
+void pacing_success(pacing *p, int turnaround)
+{
+    p->samples[p->next_sample] = turnaround;
+    p->next_sample = (p->next_sample + 1) % PACING_SAMPLES;
+    if (p->sample_count < PACING_SAMPLES) p->sample_count++;
+    p->failures = 0;
+    p->gap -= p->gap / 8;
+    if (p->gap < PACING_MIN_GAP) p->gap = PACING_MIN_GAP;
+    clock_gettime(CLOCK_MONOTONIC, &p->last_exchange);
+}
+
+void pacing_failure(pacing *p)
+{
+    p->failures++;
+    p->gap = p->gap * 2 + PACING_MIN_GAP;
+    if (p->gap > PACING_MAX_GAP) p->gap = PACING_MAX_GAP;
+    clock_gettime(CLOCK_MONOTONIC, &p->last_exchange);
+}
+
+int pacing_exchange_time(pacing const *p)
+{
+    int index, total = 0;
+    for (index = 0; index < p->sample_count; index++) {
+        total += p->samples[index];
+    }
+    return (p->sample_count > 0 ? total / p->sample_count : 0) + p->gap;
+}
@@ -0,0 +1,56 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#ifndef PACING_H
+#define PACING_H
+
+#include <time.h>
+
+// Adaptive pacing of the exchanges with a meter: The turnaround time of
+// each exchange is recorded, and the response timeout is derived from
+// the recently observed turnaround times. The gap between the end of
+// one exchange and the next request starts out small and is widened
+// only when an exchange fails, and narrowed again as exchanges succeed.
+
+#define PACING_SAMPLES 32          // Turnaround times remembered.
+#define PACING_INITIAL_TIMEOUT 3000 // Milliseconds, before any samples.
+#define PACING_MIN_TIMEOUT 100     // Milliseconds.
+#define PACING_MAX_TIMEOUT 3000    // Milliseconds.
+#define PACING_TIMEOUT_MARGIN 50   // Milliseconds added to the percentile.
+#define PACING_INITIAL_GAP 50      // Milliseconds.
+#define PACING_MIN_GAP 5           // Milliseconds.
+#define PACING_MAX_GAP 1000        // Milliseconds.
+
+typedef struct _pacing {
+    int samples[PACING_SAMPLES];   // Turnaround times in milliseconds.
+    int sample_count;
+    int next_sample;
+    int gap;                       // Milliseconds between exchanges.
+    int failures;                  // Consecutive failed exchanges.
+    struct timespec last_exchange; // End of the most recent exchange.
+} pacing;
+
+void pacing_init(pacing *p);
+
+// Milliseconds to wait for a response before giving up.
+int pacing_timeout(pacing const *p);
+
+// Milliseconds until the gap since the end of the previous exchange has
+// passed, 0 if it has.
+int pacing_delay(pacing const *p);
+
+// Wait until the gap since the end of the previous exchange has passed.
+void pacing_wait(pacing *p);
+
+// Record the end of an exchange which succeeded after `turnaround` ms.
+void pacing_success(pacing *p, int turnaround);
+
+// Record the end of an exchange which timed out or was corrupted.
+void pacing_failure(pacing *p);
+
+// Milliseconds of link time taken by an exchange: the mean recorded
+// turnaround time plus the gap.
+int pacing_exchange_time(pacing const *p);
+
+#endif
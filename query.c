@@ -0,0 +1,559 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "optical_eye_utils.h"
+#include "store.h"
+#include "variables.h"
+
+// Aggregate the records of a store: the records selected by variable,
+// meter, kind and time are grouped by meter, variable and time bucket,
+// and the count, sum, minimum, maximum, average, change (last minus
+// first value, e.g., the energy used in a day) and percentiles of each
+// group are shown, one line per group with tab separated columns.
+//
+// The store is mapped and cut into one segment per thread. A thread
+// scans its segment in blocks: the records selected are found by a
+// loop without branches on the records, their fields are gathered into
+// columns, and the columns are then bucketed and aggregated into the
+// groups of the thread, which are merged at the end.
+//
+// A percentile is found by a few more passes over the store, each of
+// which counts the values of each group in QUERY_BINS bins of the range
+// known to hold it, and narrows that range to one bin. The smallest
+// value of the final range is shown, which is within the range divided
+// by QUERY_BINS to the power of QUERY_PERCENTILE_PASSES of the exact
+// percentile (nearest rank), and exact unless the values are very dense.
+
+#ifndef QUERY_MAX_THREADS
+#define QUERY_MAX_THREADS 8
+#endif
+#ifndef QUERY_MAX_GROUPS
+#define QUERY_MAX_GROUPS 4096
+#endif
+#define QUERY_GROUP_TABLE (2 * QUERY_MAX_GROUPS)
+#ifndef QUERY_BLOCK
+#define QUERY_BLOCK 1024
+#endif
+#define QUERY_BINS 64
+#define QUERY_PERCENTILE_PASSES 4
+#define MAX_METERS 16
+#define MAX_AGGREGATES 16
+#define MAX_PERCENTILES 4
+
+typedef enum _aggregate {
+    AGGREGATE_COUNT, AGGREGATE_SUM, AGGREGATE_MIN, AGGREGATE_MAX,
+    AGGREGATE_AVG, AGGREGATE_DELTA, AGGREGATE_PERCENTILE
+} aggregate;
+
+static char const *aggregate_names[] = {
+    "count", "sum", "min", "max", "avg", "delta"
+};
+
+typedef enum _phase {
+    PHASE_AGGREGATE, PHASE_HISTOGRAM, PHASE_NEAREST
+} phase;
+
+typedef struct _group {
+    int64_t bucket;                // Start, in nanoseconds since the epoch.
+    uint32_t source;
+    uint16_t var_id;
+    uint8_t unit;
+    uint8_t used;
+    int index;                     // In the groups shown.
+    unsigned long count;
+    double sum, min, max, first, last;
+    int64_t first_time, last_time;
+} group;
+
+// The range of values known to hold a percentile of a group: the values
+// which fall in bin `chosen[level]` of the range from `low[level]` to
+// `high[level]` at every level so far.
+typedef struct _percentile_range {
+    unsigned long rank, below;     // Rank wanted, number of values below.
+    double low[QUERY_PERCENTILE_PASSES], high[QUERY_PERCENTILE_PASSES];
+    int chosen[QUERY_PERCENTILE_PASSES];
+    int levels;
+} percentile_range;
+
+typedef struct _query_thread {
+    pthread_t thread;
+    size_t first, last;            // The segment of the store.
+    store_buckets bucketing;       // With a cache of its own.
+    int group_count;
+    group groups[QUERY_GROUP_TABLE];
+    // The columns of the records selected in a block.
+    int selection[QUERY_BLOCK];
+    int64_t times[QUERY_BLOCK], buckets[QUERY_BLOCK];
+    double values[QUERY_BLOCK];
+    uint32_t sources[QUERY_BLOCK];
+    uint16_t var_ids[QUERY_BLOCK];
+    uint8_t units[QUERY_BLOCK];
+    // Of the percentile passes, indexed like the groups shown.
+    uint32_t histogram[QUERY_MAX_GROUPS][QUERY_BINS];
+    double nearest[QUERY_MAX_GROUPS];
+} query_thread;
+
+static store_record const *records;
+static size_t record_count;
+
+// The query.
+static unsigned char var_map[65536 / 8];
+static struct {
+    char const *name;
+    uint32_t source;
+} meters[MAX_METERS];
+static int meter_count = 0;
+static int kind = STORE_SAMPLE;
+static int64_t from = INT64_MIN, to = INT64_MAX;
+static store_buckets bucketing;
+static aggregate aggregates[MAX_AGGREGATES];
+static double percents[MAX_PERCENTILES];
+static int aggregate_count = 0, percentile_count = 0;
+
+static query_thread threads[QUERY_MAX_THREADS];
+static int thread_count;
+static phase current_phase;
+static group groups[QUERY_GROUP_TABLE];
+static int group_count = 0;
+static group *shown[QUERY_MAX_GROUPS];
+static percentile_range ranges[QUERY_MAX_GROUPS];
+static double percentiles[MAX_PERCENTILES][QUERY_MAX_GROUPS];
+
+void usage(char *self) {
+    printf("Usage: %s [-v var_id|partial_var_name]... [-m device]... "
+           "[-k sample|min|max|mean|last] [-f YYYYMMDD[-HHMM]] "
+           "[-t YYYYMMDD[-HHMM]] [-b seconds|hour|day|month] "
+           "[-a count|sum|min|max|avg|delta|pNN[,...]] [-j threads] "
+           "store\n", self);
+    exit(0);
+}
+
+static void add_aggregates(char *self, char *list)
+{
+    char *name;
+    for (name = strtok(list, ","); name; name = strtok(NULL, ",")) {
+        int index;
+        if (aggregate_count == MAX_AGGREGATES) usage(self);
+        if (name[0] == 'p') {
+            double percent = atof(name + 1);
+            if (percent <= 0 || percent > 100 ||
+                percentile_count == MAX_PERCENTILES) {
+                usage(self);
+            }
+            percents[percentile_count++] = percent;
+            aggregates[aggregate_count++] = AGGREGATE_PERCENTILE;
+            continue;
+        }
+        for (index = 0; index < AGGREGATE_PERCENTILE; index++) {
+            if (!strcmp(name, aggregate_names[index])) break;
+        }
+        if (index == AGGREGATE_PERCENTILE) usage(self);
+        aggregates[aggregate_count++] = index;
+    }
+}
+
+// The group of the given key in `table`, added if `count` is given and
+// it is not there, or else NULL.
+static group *group_of(group *table, int *count, int64_t bucket,
+                       uint32_t source, int var_id)
+{
+    uint64_t hash = (bucket / STORE_SECOND) * 0x9e3779b97f4a7c15ULL ^
+        source * 0xff51afd7ed558ccdULL ^ var_id;
+    unsigned int slot = (hash ^ hash >> 32) & (QUERY_GROUP_TABLE - 1);
+    while (table[slot].used) {
+        group *g = table + slot;
+        if (g->bucket == bucket && g->source == source &&
+            g->var_id == var_id) {
+            return g;
+        }
+        slot = (slot + 1) & (QUERY_GROUP_TABLE - 1);
+    }
+    if (!count) return NULL;
+    if (*count == QUERY_MAX_GROUPS) {
+        fprintf(stderr, "More than %d groups, use fewer or longer buckets\n",
+                QUERY_MAX_GROUPS);
+        exit(1);
+    }
+    (*count)++;
+    memset(table + slot, 0, sizeof(group));
+    table[slot].used = 1;
+    table[slot].bucket = bucket;
+    table[slot].source = source;
+    table[slot].var_id = var_id;
+    return table + slot;
+}
+
+// Add `count` values from `sum` to `max` to `g`.
+static void add_to_group(group *g, unsigned long count, double sum,
+                         double min, double max, int64_t first_time,
+                         double first, int64_t last_time, double last,
+                         int unit)
+{
+    if (g->count == 0) {
+        g->min = min;
+        g->max = max;
+        g->first_time = first_time;
+        g->first = first;
+        g->last_time = last_time;
+        g->last = last;
+        g->unit = unit;
+    } else {
+        if (min < g->min) g->min = min;
+        if (max > g->max) g->max = max;
+        if (first_time < g->first_time) {
+            g->first_time = first_time;
+            g->first = first;
+        }
+        if (last_time >= g->last_time) {
+            g->last_time = last_time;
+            g->last = last;
+        }
+    }
+    g->count += count;
+    g->sum += sum;
+}
+
+static inline int selects(store_record const *record)
+{
+    int meter = meter_count == 0, index;
+    for (index = 0; index < meter_count; index++) {
+        meter |= record->source == meters[index].source;
+    }
+    return meter & (record->kind == kind) & (record->time >= from) &
+        (record->time < to) &
+        (var_map[record->var_id >> 3] >> (record->var_id & 7) & 1);
+}
+
+// The bin of `value` at `level` of `range`.
+static inline int bin_of(percentile_range const *range, int level,
+                         double value)
+{
+    double width = range->high[level] - range->low[level];
+    int bin = width > 0 ?
+        (int)((value - range->low[level]) / width * QUERY_BINS) : 0;
+    return bin < 0 ? 0 : bin >= QUERY_BINS ? QUERY_BINS - 1 : bin;
+}
+
+// Whether `value` is in the range of `range` known so far. The bins
+// are computed as in the earlier passes, so no value is lost to the
+// rounding of their bounds.
+static inline int in_range(percentile_range const *range, double value)
+{
+    int level;
+    for (level = 0; level < range->levels; level++) {
+        if (bin_of(range, level, value) != range->chosen[level]) return 0;
+    }
+    return 1;
+}
+
+static void scan_block(query_thread *t, store_record const *block,
+                       int length)
+{
+    int selected = 0, index;
+    for (index = 0; index < length; index++) {
+        t->selection[selected] = index;
+        selected += selects(block + index);
+    }
+    for (index = 0; index < selected; index++) {
+        store_record const *record = block + t->selection[index];
+        t->times[index] = record->time;
+        t->values[index] = record->value;
+        t->sources[index] = record->source;
+        t->var_ids[index] = record->var_id;
+        t->units[index] = record->unit;
+    }
+    for (index = 0; index < selected; index++) {
+        t->buckets[index] = store_bucket_of(&t->bucketing, t->times[index]);
+    }
+    for (index = 0; index < selected; index++) {
+        double value = t->values[index];
+        group *g;
+        if (current_phase == PHASE_AGGREGATE) {
+            g = group_of(t->groups, &t->group_count, t->buckets[index],
+                         t->sources[index], t->var_ids[index]);
+            add_to_group(g, 1, value, value, value, t->times[index], value,
+                         t->times[index], value, t->units[index]);
+            continue;
+        }
+        g = group_of(groups, NULL, t->buckets[index], t->sources[index],
+                     t->var_ids[index]);
+        if (!in_range(ranges + g->index, value)) continue;
+        if (current_phase == PHASE_HISTOGRAM) {
+            percentile_range const *range = ranges + g->index;
+            t->histogram[g->index][bin_of(range, range->levels, value)]++;
+        } else if (value < t->nearest[g->index]) {
+            t->nearest[g->index] = value;
+        }
+    }
+}
+
+static void *query_loop(void *argument)
+{
+    query_thread *t = argument;
+    size_t base;
+    for (base = t->first; base < t->last; base += QUERY_BLOCK) {
+        int length = t->last - base < QUERY_BLOCK ?
+            t->last - base : QUERY_BLOCK;
+        scan_block(t, records + base, length);
+    }
+    return NULL;
+}
+
+static void run_phase(phase p)
+{
+    int index;
+    current_phase = p;
+    for (index = 0; index < thread_count; index++) {
+        query_thread *t = threads + index;
+        t->first = record_count * index / thread_count;
+        t->last = record_count * (index + 1) / thread_count;
+        if (p == PHASE_AGGREGATE) t->bucketing = bucketing;
+        if (p == PHASE_HISTOGRAM) {
+            memset(t->histogram, 0, group_count * sizeof(t->histogram[0]));
+        } else if (p == PHASE_NEAREST) {
+            int g;
+            for (g = 0; g < group_count; g++) t->nearest[g] = 1e308;
+        }
+        if (pthread_create(&t->thread, NULL, query_loop, t)) {
+            fail("Could not start a query thread");
+        }
+    }
+    for (index = 0; index < thread_count; index++) {
+        pthread_join(threads[index].thread, NULL);
+    }
+}
+
+static int compare_groups(void const *a, void const *b)
+{
+    group const *g = *(group const **)a, *h = *(group const **)b;
+    if (g->source != h->source) return g->source < h->source ? -1 : 1;
+    if (g->var_id != h->var_id) return g->var_id < h->var_id ? -1 : 1;
+    return g->bucket < h->bucket ? -1 : g->bucket > h->bucket;
+}
+
+static void merge_groups(void)
+{
+    int index, slot;
+    for (index = 0; index < thread_count; index++) {
+        for (slot = 0; slot < QUERY_GROUP_TABLE; slot++) {
+            group const *g = threads[index].groups + slot;
+            if (!g->used) continue;
+            add_to_group(group_of(groups, &group_count, g->bucket, g->source,
+                                  g->var_id),
+                         g->count, g->sum, g->min, g->max, g->first_time,
+                         g->first, g->last_time, g->last, g->unit);
+        }
+    }
+    index = 0;
+    for (slot = 0; slot < QUERY_GROUP_TABLE; slot++) {
+        if (groups[slot].used) shown[index++] = groups + slot;
+    }
+    qsort(shown, group_count, sizeof(*shown), compare_groups);
+    for (index = 0; index < group_count; index++) shown[index]->index = index;
+}
+
+// Find the `percent` percentile of every group into `results`.
+static void find_percentile(double percent, double *results)
+{
+    int index, pass, bin, thread;
+    for (index = 0; index < group_count; index++) {
+        percentile_range *range = ranges + index;
+        unsigned long count = shown[index]->count;
+        range->rank = (unsigned long)(percent / 100 * count + 0.999999);
+        if (range->rank < 1) range->rank = 1;
+        if (range->rank > count) range->rank = count;
+        range->below = 0;
+        range->levels = 0;
+        range->low[0] = shown[index]->min;
+        range->high[0] = shown[index]->max;
+    }
+    for (pass = 0; pass < QUERY_PERCENTILE_PASSES; pass++) {
+        run_phase(PHASE_HISTOGRAM);
+        for (index = 0; index < group_count; index++) {
+            percentile_range *range = ranges + index;
+            unsigned long below = range->below;
+            double width = range->high[pass] - range->low[pass];
+            for (bin = 0; bin < QUERY_BINS; bin++) {
+                unsigned long count = 0;
+                for (thread = 0; thread < thread_count; thread++) {
+                    count += threads[thread].histogram[index][bin];
+                }
+                if (below + count >= range->rank) break;
+                below += count;
+            }
+            if (bin == QUERY_BINS) bin = QUERY_BINS - 1;
+            range->below = below;
+            range->chosen[pass] = bin;
+            range->levels = pass + 1;
+            if (pass + 1 < QUERY_PERCENTILE_PASSES) {
+                range->low[pass + 1] =
+                    range->low[pass] + width * bin / QUERY_BINS;
+                range->high[pass + 1] =
+                    range->low[pass] + width * (bin + 1) / QUERY_BINS;
+            }
+        }
+    }
+    run_phase(PHASE_NEAREST);
+    for (index = 0; index < group_count; index++) {
+        results[index] = threads[0].nearest[index];
+        for (thread = 1; thread < thread_count; thread++) {
+            if (threads[thread].nearest[index] < results[index]) {
+                results[index] = threads[thread].nearest[index];
+            }
+        }
+    }
+}
+
+static void show_groups(void)
+{
+    int index, column, percentile = 0;
+    printf("bucket\tmeter\tvar_id\tname\tunit");
+    for (column = 0; column < aggregate_count; column++) {
+        if (aggregates[column] == AGGREGATE_PERCENTILE) {
+            printf("\tp%g", percents[percentile++]);
+        } else {
+            printf("\t%s", aggregate_names[aggregates[column]]);
+        }
+    }
+    printf("\n");
+    for (index = 0; index < group_count; index++) {
+        group const *g = shown[index];
+        char const *unit = unit_name(g->unit);
+        percentile = 0;
+        int meter;
+        if (bucketing.period == STORE_ALL) {
+            printf("all");
+        } else {
+            char text[32];
+            time_t seconds = g->bucket / STORE_SECOND;
+            struct tm tm;
+            localtime_r(&seconds, &tm);
+            strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &tm);
+            printf("%s", text);
+        }
+        for (meter = 0; meter < meter_count; meter++) {
+            if (meters[meter].source == g->source) break;
+        }
+        if (meter < meter_count) {
+            printf("\t%s", meters[meter].name);
+        } else {
+            printf("\t%08x", g->source);
+        }
+        printf("\t%d\t%s\t%s", g->var_id, var_name_of_id(g->var_id),
+               unit ? unit : "?");
+        for (column = 0; column < aggregate_count; column++) {
+            switch (aggregates[column]) {
+                case AGGREGATE_COUNT:
+                    printf("\t%lu", g->count);
+                    break;
+                case AGGREGATE_SUM:
+                    printf("\t%0.4f", g->sum);
+                    break;
+                case AGGREGATE_MIN:
+                    printf("\t%0.4f", g->min);
+                    break;
+                case AGGREGATE_MAX:
+                    printf("\t%0.4f", g->max);
+                    break;
+                case AGGREGATE_AVG:
+                    printf("\t%0.4f", g->sum / g->count);
+                    break;
+                case AGGREGATE_DELTA:
+                    printf("\t%0.4f", g->last - g->first);
+                    break;
+                case AGGREGATE_PERCENTILE:
+                    printf("\t%0.4f", percentiles[percentile++][index]);
+                    break;
+            }
+        }
+        printf("\n");
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int option, index, var_count = 0;
+
+    thread_count = sysconf(_SC_NPROCESSORS_ONLN);
+    while ((option = getopt(argc, argv, "v:m:k:f:t:b:a:j:")) != -1) {
+        switch (option) {
+            case 'v': {
+                int var_id = atoi(optarg);
+                if (var_id == 0) var_id = var_id_of_partial_name(optarg);
+                if (var_id <= 0 || var_id > 0xffff) usage(argv[0]);
+                var_map[var_id >> 3] |= 1 << (var_id & 7);
+                var_count++;
+                break;
+            }
+            case 'm':
+                if (meter_count == MAX_METERS) usage(argv[0]);
+                meters[meter_count].name = optarg;
+                meters[meter_count++].source = store_source(optarg);
+                break;
+            case 'k':
+                if (!strcmp(optarg, "sample")) {
+                    kind = STORE_SAMPLE;
+                } else if (!strcmp(optarg, "min")) {
+                    kind = STORE_MIN;
+                } else if (!strcmp(optarg, "max")) {
+                    kind = STORE_MAX;
+                } else if (!strcmp(optarg, "mean")) {
+                    kind = STORE_MEAN;
+                } else if (!strcmp(optarg, "last")) {
+                    kind = STORE_LAST;
+                } else {
+                    usage(argv[0]);
+                }
+                break;
+            case 'f':
+                if (!store_parse_time(optarg, strlen(optarg), &from)) {
+                    usage(argv[0]);
+                }
+                break;
+            case 't':
+                if (!store_parse_time(optarg, strlen(optarg), &to)) {
+                    usage(argv[0]);
+                }
+                break;
+            case 'b':
+                if (!store_buckets_init(&bucketing, optarg)) usage(argv[0]);
+                break;
+            case 'a':
+                add_aggregates(argv[0], optarg);
+                break;
+            case 'j':
+                thread_count = atoi(optarg);
+                if (thread_count < 1 || thread_count > QUERY_MAX_THREADS) {
+                    usage(argv[0]);
+                }
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (argc - optind != 1) usage(argv[0]);
+    if (thread_count < 1) thread_count = 1;
+    if (thread_count > QUERY_MAX_THREADS) thread_count = QUERY_MAX_THREADS;
+    if (var_count == 0) memset(var_map, 0xff, sizeof(var_map));
+    if (aggregate_count == 0) {
+        char defaults[] = "count,min,max,avg";
+        add_aggregates(argv[0], defaults);
+    }
+    records = store_map(argv[optind], &record_count);
+    if (!records) fail("Could not map the store");
+
+    run_phase(PHASE_AGGREGATE);
+    merge_groups();
+    for (index = 0; index < percentile_count; index++) {
+        find_percentile(percents[index], percentiles[index]);
+    }
+    show_groups();
+    return 0;
+}
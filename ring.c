@@ -0,0 +1,170 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#include <string.h>
+#include <time.h>
+#include "ring.h"
+
+#define RING_MASK (RING_LENGTH - 1)
+#define RING_WAIT_NANOSECONDS 100000
+
+void ring_init(ring *r, ring_policy policy)
+{
+    size_t index;
+    for (index = 0; index < RING_LENGTH; index++) {
+        atomic_init(&r->cells[index].sequence, index);
+        atomic_init(&r->cells[index].parts, 1);
+    }
+    r->policy = policy;
+    atomic_init(&r->enqueue_position, 0);
+    atomic_init(&r->dequeue_position, 0);
+    atomic_init(&r->pushed, 0);
+    atomic_init(&r->dropped, 0);
+    atomic_init(&r->dropped_samples, 0);
+    atomic_init(&r->waits, 0);
+}
+
+// Claim `parts` consecutive cells for writing, and return the first,
+// or NULL if the ring does not have room for them all.
+static ring_cell *claim_for_write(ring *r, int parts, size_t *position)
+{
+    size_t current = atomic_load_explicit(&r->enqueue_position,
+                                          memory_order_relaxed);
+    while (1) {
+        long difference = 0;
+        int part;
+        for (part = 0; part < parts && difference == 0; part++) {
+            ring_cell *cell = r->cells + ((current + part) & RING_MASK);
+            size_t sequence = atomic_load_explicit(&cell->sequence,
+                                                   memory_order_acquire);
+            difference = (long)sequence - (long)(current + part);
+        }
+        if (difference == 0) {
+            if (atomic_compare_exchange_weak_explicit(
+                    &r->enqueue_position, &current, current + parts,
+                    memory_order_relaxed, memory_order_relaxed)) {
+                *position = current;
+                return r->cells + (current & RING_MASK);
+            }
+        } else if (difference < 0) {
+            return NULL;
+        } else {
+            current = atomic_load_explicit(&r->enqueue_position,
+                                           memory_order_relaxed);
+        }
+    }
+}
+
+// Claim the cells of the oldest push for reading, setting `parts` to
+// their number, or return NULL if the ring is empty, or the oldest push
+// is still being written.
+static ring_cell *claim_for_read(ring *r, int *parts, size_t *position)
+{
+    size_t current = atomic_load_explicit(&r->dequeue_position,
+                                          memory_order_relaxed);
+    while (1) {
+        ring_cell *cell = r->cells + (current & RING_MASK);
+        size_t sequence = atomic_load_explicit(&cell->sequence,
+                                               memory_order_acquire);
+        long difference = (long)sequence - (long)(current + 1);
+        if (difference == 0) {
+            int count = atomic_load_explicit(&cell->parts,
+                                             memory_order_relaxed);
+            int part;
+            for (part = 1; part < count && difference == 0; part++) {
+                ring_cell *next = r->cells + ((current + part) & RING_MASK);
+                sequence = atomic_load_explicit(&next->sequence,
+                                                memory_order_acquire);
+                difference = (long)sequence - (long)(current + part + 1);
+            }
+            if (difference == 0) {
+                if (atomic_compare_exchange_weak_explicit(
+                        &r->dequeue_position, &current, current + count,
+                        memory_order_relaxed, memory_order_relaxed)) {
+                    *parts = count;
+                    *position = current;
+                    return cell;
+                }
+                continue;
+            }
+        }
+        if (difference < 0) {
+            return NULL;
+        } else {
+            current = atomic_load_explicit(&r->dequeue_position,
+                                           memory_order_relaxed);
+        }
+    }
+}
+
+int ring_pop(ring *r, ring_visitor visit, void *context)
+{
+    size_t position;
+    int parts, part;
+    if (!claim_for_read(r, &parts, &position)) return 0;
+    for (part = 0; part < parts; part++) {
+        ring_cell *cell = r->cells + ((position + part) & RING_MASK);
+        if (visit) visit(&cell->record, context);
+        atomic_store_explicit(&cell->sequence, position + part + RING_LENGTH,
+                              memory_order_release);
+    }
+    return 1;
+}
+
+int ring_depth(ring *r)
+{
+    size_t enqueued = atomic_load(&r->enqueue_position);
+    size_t dequeued = atomic_load(&r->dequeue_position);
+    return enqueued > dequeued ? (int)(enqueued - dequeued) : 0;
+}
+
+static void wait_for_room(ring *r)
+{
+    struct timespec pause = {0, RING_WAIT_NANOSECONDS};
+    atomic_fetch_add(&r->waits, 1);
+    nanosleep(&pause, NULL);
+}
+
+int ring_push(ring *r, int destination, int sample, void const *data,
+              int length)
+{
+    size_t position;
+    unsigned char const *next = data;
+    int parts = length > RING_RECORD_LENGTH ?
+        (length + RING_RECORD_LENGTH - 1) / RING_RECORD_LENGTH : 1;
+    int part;
+    if (parts > RING_MAX_PARTS) return 0;
+    if (r->policy == RING_ROLLUP_ONLY && sample &&
+        ring_depth(r) >= RING_LENGTH * 3 / 4) {
+        atomic_fetch_add(&r->dropped_samples, 1);
+        return 0;
+    }
+    while (!claim_for_write(r, parts, &position)) {
+        if (r->policy == RING_DROP_OLDEST && ring_pop(r, NULL, NULL)) {
+            atomic_fetch_add(&r->dropped, 1);
+        } else {
+            wait_for_room(r);
+        }
+    }
+    for (part = 0; part < parts; part++) {
+        ring_cell *cell = r->cells + ((position + part) & RING_MASK);
+        int chunk = length < RING_RECORD_LENGTH ? length : RING_RECORD_LENGTH;
+        cell->record.destination = destination;
+        cell->record.sample = sample;
+        cell->record.length = chunk;
+        memcpy(cell->record.data, next, chunk);
+        atomic_store_explicit(&cell->parts, part == 0 ? parts : 0,
+                              memory_order_relaxed);
+        next += chunk;
+        length -= chunk;
+    }
+    // The first cell last, so a consumer finds the push complete.
+    for (part = parts - 1; part >= 0; part--) {
+        ring_cell *cell = r->cells + ((position + part) & RING_MASK);
+        atomic_store_explicit(&cell->sequence, position + part + 1,
+                              memory_order_release);
+    }
+    atomic_fetch_add_explicit(&r->pushed, 1, memory_order_relaxed);
+    return 1;
+}
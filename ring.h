@@ -0,0 +1,85 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#ifndef RING_H
+#define RING_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+// A bounded lock-free queue of fixed size records, for any number of
+// producers and consumers. Each cell carries a sequence number telling
+// whether it is ready to be written or read in the current lap, so
+// producers and consumers only contend on the positions, using
+// compare-and-swap. What happens when the ring is full is decided by
+// the policy of the ring.
+//
+// A push longer than one record takes consecutive cells, claimed with a
+// single compare-and-swap, and they are taken out again as a unit. So
+// the records of a push are never interleaved with those of another
+// producer, and a policy keeps or drops them all.
+
+#ifndef RING_LENGTH
+#define RING_LENGTH 1024           // Records, must be a power of two.
+#endif
+#ifndef RING_RECORD_LENGTH
+#define RING_RECORD_LENGTH 1024    // Bytes of data in a record.
+#endif
+#define RING_MAX_PARTS (RING_LENGTH / 4) // Records in one push.
+
+typedef enum _ring_policy {
+    RING_BLOCK,                    // Wait for room.
+    RING_DROP_OLDEST,              // Drop the oldest record to make room.
+    RING_ROLLUP_ONLY,              // Drop samples once 3/4 full, else wait.
+} ring_policy;
+
+// Records are samples, which the policy RING_ROLLUP_ONLY may drop, or
+// essential, e.g., rollups and failures. The destination tells the
+// consumer what to do with the data.
+#define RING_SAMPLE 1
+#define RING_ESSENTIAL 0
+
+typedef struct _ring_record {
+    unsigned char destination;
+    unsigned char sample;
+    unsigned short length;
+    unsigned char data[RING_RECORD_LENGTH];
+} ring_record;
+
+typedef struct _ring_cell {
+    atomic_size_t sequence;
+    atomic_int parts;              // Records of the push from this one.
+    ring_record record;
+} ring_cell;
+
+typedef struct _ring {
+    ring_cell cells[RING_LENGTH];
+    ring_policy policy;
+    // The positions are on cache lines of their own, as they are
+    // written by producers and consumers, respectively.
+    _Alignas(64) atomic_size_t enqueue_position;
+    _Alignas(64) atomic_size_t dequeue_position;
+    _Alignas(64) atomic_ulong pushed;
+    atomic_ulong dropped;          // Pushes dropped to make room.
+    atomic_ulong dropped_samples;  // Samples refused by RING_ROLLUP_ONLY.
+    atomic_ulong waits;            // Times a producer had to wait.
+} ring;
+
+void ring_init(ring *r, ring_policy policy);
+
+// Queue `length` bytes of `data`, at most RING_MAX_PARTS records, in as
+// few records as possible, applying the policy when the ring is full.
+// Returns zero if the push was dropped.
+int ring_push(ring *r, int destination, int sample, void const *data,
+              int length);
+
+// Take the oldest push out of the ring, passing its records in order to
+// `visit`, unless it is NULL. Returns zero if the ring is empty.
+typedef void (*ring_visitor)(ring_record const *record, void *context);
+int ring_pop(ring *r, ring_visitor visit, void *context);
+
+// The number of records in the ring; approximate while it changes.
+int ring_depth(ring *r);
+
+#endif
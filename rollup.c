@@ -0,0 +1,42 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#include "rollup.h"
+
+void rollup_init(rollup *r, int window)
+{
+    r->window = window;
+    r->start = 0;
+    r->count = 0;
+}
+
+int rollup_close(rollup *r, time_t now, rollup *closed)
+{
+    if (r->start == 0 || now < r->start + r->window) return 0;
+    if (r->count == 0) {
+        r->start = 0;
+        return 0;
+    }
+    *closed = *r;
+    r->start = 0;
+    r->count = 0;
+    return 1;
+}
+
+void rollup_add(rollup *r, time_t now, double value)
+{
+    if (r->start == 0) r->start = now - now % r->window;
+    if (r->count == 0 || value < r->min) r->min = value;
+    if (r->count == 0 || value > r->max) r->max = value;
+    r->sum = r->count == 0 ? value : r->sum + value;
+    r->last = value;
+    r->count++;
+}
+
+int rollup_remaining(rollup const *r, time_t now)
+{
+    if (r->start == 0) return -1;
+    int remaining = r->start + r->window - now;
+    return remaining > 0 ? remaining : 0;
+}
@@ -0,0 +1,37 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#ifndef ROLLUP_H
+#define ROLLUP_H
+
+#include <time.h>
+
+// Incremental aggregation of the samples of one register over windows
+// of a fixed length. Windows are aligned to multiples of their length
+// in wall clock time, such that, e.g., 15 minute windows start on the
+// quarter hour. A window is closed by the first sample, or check, at or
+// after its end.
+
+typedef struct _rollup {
+    int window;                    // Seconds.
+    time_t start;                  // Start of the window, 0 before use.
+    int count;                     // Samples in the window.
+    double min, max, sum, last;
+} rollup;
+
+void rollup_init(rollup *r, int window);
+
+// Close the current window if it has ended at `now`. The closed window
+// is copied to `closed` if it had any samples, and 1 is returned.
+int rollup_close(rollup *r, time_t now, rollup *closed);
+
+// Add a sample taken at `now`. Call `rollup_close` first, such that a
+// window which has ended is reported before the sample is added.
+void rollup_add(rollup *r, time_t now, double value);
+
+// Seconds from `now` until the current window ends, or -1 if there is
+// no current window.
+int rollup_remaining(rollup const *r, time_t now);
+
+#endif
@@ -0,0 +1,46 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#include <math.h>
+#include "sampler.h"
+
+void sampler_init(sampler *s, int base_period, int fast_period,
+                  double absolute, double relative, double rate)
+{
+    s->base_period = base_period;
+    s->fast_period = fast_period < base_period ? fast_period : base_period;
+    s->absolute = absolute;
+    s->relative = relative;
+    s->rate = rate;
+    s->period = base_period;
+    s->changed.tv_sec = s->changed.tv_nsec = 0;
+    s->triggers = 0;
+}
+
+int sampler_update(sampler *s, double previous,
+                   struct timespec const *previous_time, double value,
+                   struct timespec const *time)
+{
+    double change = fabs(value - previous);
+    double seconds = (time->tv_sec - previous_time->tv_sec) +
+        (time->tv_nsec - previous_time->tv_nsec) / 1e9;
+    double since_changed = (time->tv_sec - s->changed.tv_sec) +
+        (time->tv_nsec - s->changed.tv_nsec) / 1e9;
+    int changed = (s->absolute > 0 && change > s->absolute) ||
+        (s->relative > 0 && change > s->relative * fabs(previous)) ||
+        (s->rate > 0 && seconds > 0 && change / seconds > s->rate);
+    if (changed) {
+        int shortened = s->period > s->fast_period;
+        s->period = s->fast_period;
+        s->changed = *time;
+        s->triggers++;
+        return shortened;
+    }
+    if (s->period < s->base_period && since_changed * 1000 >= s->period) {
+        s->period = s->period < s->base_period / 2 ? 2 * s->period :
+            s->base_period;
+        s->changed = *time;
+    }
+    return 0;
+}
@@ -0,0 +1,38 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <time.h>
+
+// Adaptive sampling of a group of registers: the group is polled at a
+// slow base period while its values are stable, and at a fast period as
+// soon as a value changes by more than a threshold, "<number>" or
+// "<number>%", or faster than a rate of change in units per second.
+// The period then doubles for every period which passes without such a
+// change in any register of the group, until it is back at the base.
+
+typedef struct _sampler {
+    int base_period;               // Milliseconds.
+    int fast_period;               // Milliseconds.
+    double absolute, relative;     // Change thresholds, 0: none.
+    double rate;                   // Per second, 0: none.
+    int period;                    // Current period, milliseconds.
+    struct timespec changed;       // When the period was last changed.
+    unsigned long triggers;        // Changes which raised the rate.
+} sampler;
+
+void sampler_init(sampler *s, int base_period, int fast_period,
+                  double absolute, double relative, double rate);
+
+// Update the period given that a register of the group went from
+// `previous` at `previous_time` to `value` at `time`. Returns nonzero if
+// the period was shortened, such that polls already scheduled should be
+// moved closer.
+int sampler_update(sampler *s, double previous,
+                   struct timespec const *previous_time, double value,
+                   struct timespec const *time);
+
+#endif
@@ -0,0 +1,484 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include "frames.h"
+#include "health.h"
+#include "optical_eye_utils.h"
+#include "pacing.h"
+#include "session.h"
+#include "trace.h"
+#include "variables.h"
+
+void session_init(session *s, int fd, char const *device,
+                  response_handler on_response, void *context)
+{
+    memset(s, 0, sizeof(*s));
+    s->fd = fd;
+    s->device = device;
+    s->on_response = on_response;
+    s->context = context;
+    session_set_address(s, KMP_DEFAULT_ADDRESS);
+    pacing_init(&s->pacing);
+    health_init(&s->health);
+    meter_clock_init(&s->clock);
+    s->meter_error = -1;
+}
+
+void session_set_address(session *s, int address)
+{
+    s->address = address;
+    register_cache_init(&s->registers, address);
+}
+
+void bus_init(bus *b)
+{
+    memset(b, 0, sizeof(*b));
+}
+
+int bus_join(bus *b, session *s)
+{
+    if (b->unit_count == BUS_MAX_UNITS) return 0;
+    b->units[b->unit_count++] = s;
+    s->bus = b;
+    return 1;
+}
+
+// Milliseconds until a keep-alive is due on `s` when it is idle, or -1
+// if it does not send keep-alives.
+static int keepalive_delay(session const *s)
+{
+    int remaining;
+    if (s->keepalive <= 0) return -1;
+    if (s->pacing.last_exchange.tv_sec == 0 &&
+        s->pacing.last_exchange.tv_nsec == 0) {
+        return 0;
+    }
+    remaining = s->keepalive - milliseconds_since(&s->pacing.last_exchange);
+    return remaining > 0 ? remaining : 0;
+}
+
+// Milliseconds until the RTC of the meter is due to be read, or -1 if
+// the session does not read it.
+static int clock_delay(session const *s)
+{
+    int remaining;
+    if (s->clock_interval <= 0) return -1;
+    if (s->clock_read.tv_sec == 0 && s->clock_read.tv_nsec == 0) return 0;
+    remaining = s->clock_interval - milliseconds_since(&s->clock_read);
+    return remaining > 0 ? remaining : 0;
+}
+
+// Milliseconds until `s` may start an exchange as far as pacing goes,
+// taking the exchanges of the other units on its bus into account.
+static int line_delay(session const *s)
+{
+    int delay = pacing_delay(&s->pacing), gap;
+    bus const *b = s->bus;
+    if (!b) return delay;
+    if (b->owner && b->owner != s) {
+        gap = b->owner->timeout - milliseconds_since(&b->owner->started);
+        return gap > 0 ? gap : 0;
+    }
+    if (b->last_exchange.tv_sec != 0 || b->last_exchange.tv_nsec != 0) {
+        gap = s->pacing.gap - milliseconds_since(&b->last_exchange);
+        if (gap > delay) delay = gap;
+    }
+    return delay;
+}
+
+int session_submit(session *s, int var_id, request_priority priority)
+{
+    request_queue *queue = s->queues + priority;
+    if (queue->count == SESSION_QUEUE_LENGTH) return 0;
+    queue->var_ids[(queue->first + queue->count) % SESSION_QUEUE_LENGTH] =
+        var_id;
+    queue->count++;
+    return 1;
+}
+
+int session_queued(session const *s, request_priority priority)
+{
+    return s->queues[priority].count;
+}
+
+int session_contains(session const *s, int var_id,
+                     request_priority priority)
+{
+    request_queue const *queue = s->queues + priority;
+    int index;
+    if (s->busy && !s->probing && s->var_id == var_id &&
+        s->priority == priority) {
+        return 1;
+    }
+    for (index = 0; index < queue->count; index++) {
+        if (queue->var_ids[(queue->first + index) % SESSION_QUEUE_LENGTH] ==
+            var_id) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int session_idle(session const *s)
+{
+    int priority;
+    if (s->busy) return 0;
+    for (priority = 0; priority < PRIORITY_CLASSES; priority++) {
+        if (s->queues[priority].count > 0) return 0;
+    }
+    return 1;
+}
+
+int session_wakeup(session const *s)
+{
+    if (s->busy) {
+        int remaining = s->timeout - milliseconds_since(&s->started);
+        return remaining > 0 ? remaining : 0;
+    }
+    if (s->fd < 0) return session_idle(s) ? -1 : 0;
+    if (s->health.state == CIRCUIT_OPEN) {
+        int delay = health_probe_delay(&s->health);
+        // Queued requests are refused by the next `session_service`.
+        if (!session_idle(s)) return 0;
+        return delay > line_delay(s) ? delay : line_delay(s);
+    }
+    if (session_idle(s)) {
+        int delay = keepalive_delay(s), clock = clock_delay(s);
+        if (clock >= 0 && (delay < 0 || clock < delay)) delay = clock;
+        if (delay < 0) return -1;
+        return delay > line_delay(s) ? delay : line_delay(s);
+    }
+    return line_delay(s);
+}
+
+static void send_request(session *s, int var_id)
+{
+    request_frame const *frame = request_frame_of(var_id);
+    int64_t write_start = TRACE_NOW();
+    s->var_id = var_id;
+    s->busy = 1;
+    s->response_started = 0;
+    s->received = 0;
+    s->timeout = pacing_timeout(&s->pacing);
+    clock_gettime(CLOCK_MONOTONIC, &s->started);
+    clock_gettime(CLOCK_REALTIME, &s->sent);
+    if (s->bus) s->bus->owner = s;
+    if (frame && s->address == KMP_DEFAULT_ADDRESS) {
+        write(s->fd, frame->bytes, frame->length);
+    } else {
+        // Not in `var_data`, or for another unit, so there is no
+        // prebuilt frame.
+        unsigned char request[READ_REQUEST_LENGTH];
+        build_read_request(request, s->address, var_id);
+        optical_eye_write(s->fd, request, READ_REQUEST_LENGTH);
+    }
+    TRACE_SPAN("request write", TRACE_DEVICE_TRACK, s->device, var_id,
+               write_start);
+    s->trace_mark = TRACE_NOW();
+}
+
+static int refusing(session const *s)
+{
+    return s->fd < 0 || s->health.state == CIRCUIT_OPEN;
+}
+
+// Nonzero if `s` has an exchange to start on the line, and is not
+// backing off. It may still have to wait for the gap after the exchange
+// of another unit, which then waits for it.
+static int ready(session const *s)
+{
+    int priority;
+    if (s->busy || s->fd < 0 || pacing_delay(&s->pacing) > 0) return 0;
+    if (s->health.state == CIRCUIT_OPEN) {
+        return health_probe_delay(&s->health) == 0;
+    }
+    for (priority = 0; priority < PRIORITY_CLASSES; priority++) {
+        if (s->queues[priority].count > 0) return 1;
+    }
+    return keepalive_delay(s) == 0 || clock_delay(s) == 0;
+}
+
+// Nonzero if it is the turn of `s` on its bus: no unit from the one
+// whose turn it is and up to `s` is ready.
+static int taking_turn(session const *s)
+{
+    bus const *b = s->bus;
+    int index;
+    if (!b) return 1;
+    if (b->owner) return 0;
+    for (index = 0; index < b->unit_count; index++) {
+        session const *unit = b->units[(b->next + index) % b->unit_count];
+        if (unit == s) return 1;
+        if (ready(unit)) return 0;
+    }
+    return 1;
+}
+
+// End the queued requests at once while the circuit is open or the
+// device is disconnected.
+static void refuse_queued(session *s)
+{
+    int priority;
+    for (priority = 0; priority < PRIORITY_CLASSES; priority++) {
+        request_queue *queue = s->queues + priority;
+        while (queue->count > 0 && refusing(s)) {
+            int var_id = queue->var_ids[queue->first];
+            queue->first = (queue->first + 1) % SESSION_QUEUE_LENGTH;
+            queue->count--;
+            s->on_response(s, var_id, priority, s->buffer, -1, 0);
+        }
+    }
+}
+
+static void start_next(session *s)
+{
+    int priority;
+    if (s->health.state == CIRCUIT_OPEN) {
+        if (health_probe_delay(&s->health) == 0) {
+            health_probe_sent(&s->health);
+            s->probing = 1;
+            send_request(s, HEALTH_PROBE_VAR_ID);
+        }
+        return;
+    }
+    for (priority = 0; priority < PRIORITY_CLASSES; priority++) {
+        request_queue *queue = s->queues + priority;
+        if (priority == PRIORITY_SCHEDULED && clock_delay(s) == 0) {
+            // Ahead of the polls, which may never leave the queue empty.
+            s->probing = 1;
+            s->reading_clock = 1;
+            send_request(s, RTC_VAR_ID);
+            return;
+        }
+        if (queue->count == 0) continue;
+        s->priority = priority;
+        s->probing = 0;
+        send_request(s, queue->var_ids[queue->first]);
+        queue->first = (queue->first + 1) % SESSION_QUEUE_LENGTH;
+        queue->count--;
+        return;
+    }
+    if (keepalive_delay(s) == 0) {
+        s->probing = 1;
+        s->keeping_alive = 1;
+        s->keepalives++;
+        send_request(s, HEALTH_PROBE_VAR_ID);
+    }
+}
+
+// Use the RTC value in the response to the exchange which has just
+// ended, if it holds one, and stamp the exchange with the offset of the
+// meter clock.
+static void track_clock(session *s, int length, int intact)
+{
+    struct timespec received;
+    int64_t sent, now;
+    time_t meter;
+    clock_gettime(CLOCK_REALTIME, &received);
+    sent = s->sent.tv_sec * 1000000000LL + s->sent.tv_nsec;
+    now = received.tv_sec * 1000000000LL + received.tv_nsec;
+    if (intact && s->var_id == RTC_VAR_ID &&
+        package_rtc_time(s->buffer, length, s->address, RTC_VAR_ID,
+                         &meter)) {
+        meter_clock_add(&s->clock, sent, now, meter * 1000000000LL);
+    }
+    if (s->reading_clock) {
+        clock_gettime(CLOCK_MONOTONIC, &s->clock_read);
+        s->reading_clock = 0;
+    }
+    if (!meter_clock_estimate(&s->clock, sent / 2 + now / 2,
+                              &s->meter_offset, &s->meter_error)) {
+        s->meter_error = -1;
+    }
+}
+
+static void end_exchange(session *s, int complete)
+{
+    int length = s->received, intact = 0;
+    int turnaround = milliseconds_since(&s->started);
+    int64_t parse_start = TRACE_NOW();
+    if (!complete) {
+        TRACE_SPAN("timeout", TRACE_DEVICE_TRACK, s->device, s->var_id,
+                   s->trace_mark);
+    }
+    if (complete) {
+        length = descape_package(s->buffer, length);
+        intact = length >= 6 &&
+            crc16(s->buffer + 1, length - 4) ==
+            ((s->buffer[length - 3] << 8) | s->buffer[length - 2]);
+    } else if (length > 0) {
+        length = descape_package(s->buffer, length);
+    }
+    TRACE_SPAN("parse", TRACE_DEVICE_TRACK, s->device, s->var_id,
+               parse_start);
+    if (intact) {
+        pacing_success(&s->pacing, turnaround);
+        health_success(&s->health);
+    } else {
+        pacing_failure(&s->pacing);
+        health_failure(&s->health, !complete);
+    }
+    if (s->keeping_alive) {
+        if (intact) {
+            s->keepalive_turnaround = turnaround;
+        } else {
+            s->keepalive_failures++;
+        }
+        s->keeping_alive = 0;
+    }
+    track_clock(s, length, intact);
+    s->busy = 0;
+    if (s->bus) {
+        bus *b = s->bus;
+        int index;
+        b->owner = NULL;
+        clock_gettime(CLOCK_MONOTONIC, &b->last_exchange);
+        for (index = 0; index < b->unit_count; index++) {
+            if (b->units[index] == s) b->next = (index + 1) % b->unit_count;
+        }
+    }
+    if (!s->probing) {
+        s->on_response(s, s->var_id, s->priority, s->buffer, length, intact);
+    }
+}
+
+// Nonzero if the complete response received is from another unit than
+// `s`, in which case it is discarded.
+static int stray_response(session *s)
+{
+    int address;
+    if (!s->bus || s->received < 3) return 0;
+    address = s->buffer[1] == 0x1b ? s->buffer[2] ^ 0xff : s->buffer[1];
+    if (address == s->address) return 0;
+    // Its bytes have been traced as a response; wait for the next one.
+    s->trace_mark = TRACE_NOW();
+    s->bus->stray++;
+    s->received = 0;
+    s->response_started = 0;
+    return 1;
+}
+
+// Take the bytes available from the device. Returns 1 when the complete
+// response package has been received, and -1 if the device is gone.
+static int receive(session *s)
+{
+    while (s->received < RESPONSE_BUFFER_LENGTH &&
+           optical_eye_readable(s->fd, 0)) {
+        unsigned char *start = s->buffer + s->received, *end;
+        int received = read(s->fd, start,
+                            RESPONSE_BUFFER_LENGTH - s->received);
+        // Readable with nothing to read is a hangup, e.g., an unplugged
+        // USB adapter.
+        if (received == 0) return -1;
+        if (received < 0) {
+            return errno == EAGAIN || errno == EINTR ? 0 : -1;
+        }
+        if (!s->response_started) {
+            // We may need to skip an echo first, so we wait for the
+            // response package start byte 0x40.
+            unsigned char *mark = memchr(start, 0x40, received);
+            if (!mark) continue;
+            received -= mark - start;
+            memmove(start, mark, received);
+            s->response_started = 1;
+            if (trace_enabled) {
+                int64_t now = trace_clock();
+                trace_span("echo skip", TRACE_DEVICE_TRACK, s->device,
+                           s->var_id, s->trace_mark, now);
+                s->trace_mark = now;
+            }
+        }
+        end = memchr(start, '\r', received);
+        if (end) {
+            s->received = end - s->buffer + 1;
+            TRACE_SPAN("response bytes", TRACE_DEVICE_TRACK, s->device,
+                       s->var_id, s->trace_mark);
+            return 1;
+        }
+        s->received += received;
+    }
+    return s->received == RESPONSE_BUFFER_LENGTH;
+}
+
+static void detach_unit(session *s)
+{
+    s->fd = -1;
+    s->keeping_alive = 0;
+    s->reading_clock = 0;
+    if (s->bus && s->bus->owner == s) s->bus->owner = NULL;
+    if (s->busy) {
+        // The exchange in flight ends without a response, but this says
+        // nothing about the health of the meter.
+        s->busy = 0;
+        if (!s->probing) {
+            s->on_response(s, s->var_id, s->priority, s->buffer, 0, 0);
+        }
+    }
+}
+
+void session_detach(session *s)
+{
+    int index;
+    if (s->fd >= 0) close(s->fd);
+    if (!s->bus) {
+        detach_unit(s);
+        return;
+    }
+    for (index = 0; index < s->bus->unit_count; index++) {
+        detach_unit(s->bus->units[index]);
+    }
+}
+
+void session_attach(session *s, int fd)
+{
+    int index;
+    if (!s->bus) {
+        s->fd = fd;
+        return;
+    }
+    for (index = 0; index < s->bus->unit_count; index++) {
+        s->bus->units[index]->fd = fd;
+    }
+}
+
+void session_service(session *s)
+{
+    if (s->busy) {
+        int status = receive(s);
+        if (status < 0) {
+            session_detach(s);
+        } else if (status > 0) {
+            if (!stray_response(s)) end_exchange(s, 1);
+        } else if (milliseconds_since(&s->started) >= s->timeout) {
+            end_exchange(s, 0);
+        }
+    }
+    if (!s->busy && refusing(s)) refuse_queued(s);
+    if (!s->busy && s->fd >= 0 && line_delay(s) == 0 && taking_turn(s)) {
+        start_next(s);
+    }
+}
+
+// Nonzero if the RTC of the meter is due to be read, and can be.
+static int clock_due(session const *s)
+{
+    return s->fd >= 0 && s->health.state != CIRCUIT_OPEN &&
+        clock_delay(s) == 0;
+}
+
+void session_drain(session *s)
+{
+    while (!session_idle(s) || clock_due(s)) {
+        int wakeup = session_wakeup(s);
+        if (s->busy) {
+            optical_eye_readable(s->fd, wakeup);
+        } else if (wakeup > 0) {
+            pacing_wait(&s->pacing);
+        }
+        session_service(s);
+    }
+}
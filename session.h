@@ -0,0 +1,181 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <stdint.h>
+#include <time.h>
+#include "health.h"
+#include "meterclock.h"
+#include "optical_eye_utils.h"
+#include "pacing.h"
+#include "variables.h"
+
+// A session owns the link to one optical eye, and performs one exchange
+// at a time with the meter. Requests are queued in priority classes,
+// and whenever an exchange has ended, the next one is taken from the
+// highest priority class which is not empty. An exchange in flight is
+// never aborted, so an interactive request goes out at the next frame
+// boundary. The session is driven by `session_service`, which never
+// blocks, such that one event loop can serve many sessions.
+//
+// While the circuit breaker in `health` is open, queued requests are
+// ended at once as failed, without any traffic, and the device is only
+// probed now and then. The same happens to requests while the device
+// is disconnected, i.e., `fd` is -1. The rest of the session state is
+// kept until the device is attached again.
+//
+// The first exchange after an idle period can be much slower than the
+// following ones, e.g., while the optical head wakes up. With
+// `keepalive` set, a session which has been idle that long sends the
+// heartbeat frame, the cheapest valid request, as for a health probe,
+// so the link stays warm. Its round trip counts for the pacing and
+// health as any exchange, and is also recorded on its own.
+//
+// Several meter units can share one multi-drop line, each with its own
+// address and session, joined to the bus of the line. Only one exchange
+// is in flight on the line at a time, the units with requests take
+// turns in round robin, and the gap of a unit is kept after any
+// exchange on the line. A complete response from another address than
+// the one in flight, e.g., a late response to an exchange which timed
+// out, is discarded and counted as stray.
+//
+// With `clock_interval` set, the session reads the RTC of the meter
+// that often, ahead of the scheduled polls, and keeps an estimate of
+// the meter clock, see meterclock.h. RTC values read on request are
+// used as well. Each exchange is then stamped with the offset of the
+// meter clock at its middle, which is about when the meter took the
+// value, so samples can be given in meter time without reading the
+// RTC along with them.
+
+#ifndef SESSION_QUEUE_LENGTH
+#define SESSION_QUEUE_LENGTH 64
+#endif
+#ifndef BUS_MAX_UNITS
+#define BUS_MAX_UNITS 16
+#endif
+
+typedef enum _request_priority {
+    PRIORITY_INTERACTIVE,  // Operator requests.
+    PRIORITY_SCHEDULED,    // Periodic polls.
+    PRIORITY_BULK,         // Sweeps and discovery, using left over time.
+    PRIORITY_CLASSES
+} request_priority;
+
+typedef struct _request_queue {
+    int var_ids[SESSION_QUEUE_LENGTH];
+    int first;
+    int count;
+} request_queue;
+
+struct _session;
+
+typedef struct _bus {
+    struct _session *units[BUS_MAX_UNITS];
+    int unit_count;
+    struct _session *owner;        // The unit with an exchange in flight.
+    int next;                      // The unit whose turn it is.
+    struct timespec last_exchange; // End of the most recent exchange.
+    unsigned long stray;           // Responses from other addresses.
+} bus;
+
+// Called when an exchange has ended. `package` holds the descaped
+// response, and `length` is 0 if nothing was received. `intact` is
+// nonzero if the package was complete and had a correct CRC. Requests
+// refused because the circuit is open or the device is disconnected
+// also end here, with `length` -1.
+typedef void (*response_handler)(struct _session *s, int var_id,
+                                 request_priority priority,
+                                 unsigned char *package, int length,
+                                 int intact);
+
+typedef struct _session {
+    int fd;
+    char const *device;
+    int address;                   // Of the meter unit.
+    bus *bus;                      // Of a multi-drop line, or NULL.
+    pacing pacing;
+    health health;
+    register_cache registers;      // Metadata of the meter's registers.
+    request_queue queues[PRIORITY_CLASSES];
+    response_handler on_response;
+    void *context;                 // For use by `on_response`.
+
+    // The exchange in flight, if `busy`.
+    int busy;
+    int var_id;
+    request_priority priority;
+    int probing;                   // A health probe, not a request.
+    int keeping_alive;             // The probe is a keep-alive.
+    int reading_clock;             // The probe is a read of the RTC.
+    struct timespec started;
+    struct timespec sent;          // CLOCK_REALTIME, at `started`.
+    int timeout;                   // Milliseconds.
+    int response_started;          // Start byte 0x40 has been received.
+    int received;
+    unsigned char buffer[RESPONSE_BUFFER_LENGTH];
+    int64_t trace_mark;            // Start of the current stage, see trace.h.
+
+    int keepalive;                 // Idle milliseconds, 0: no keep-alives.
+    unsigned long keepalives;      // Keep-alives sent.
+    unsigned long keepalive_failures;
+    int keepalive_turnaround;      // Milliseconds, of the last intact one.
+
+    int clock_interval;            // Milliseconds, 0: no reads of the RTC.
+    struct timespec clock_read;    // When the RTC was last read.
+    meter_clock clock;
+    // For `on_response`: the offset of the meter clock from CLOCK_REALTIME
+    // in the middle of the exchange, and the bound on its error, in
+    // nanoseconds. The bound is -1 while the meter clock is unknown.
+    int64_t meter_offset, meter_error;
+} session;
+
+// Start a session with the unit at KMP_DEFAULT_ADDRESS.
+void session_init(session *s, int fd, char const *device,
+                  response_handler on_response, void *context);
+
+// Talk to the unit at `address` instead, before any exchange.
+void session_set_address(session *s, int address);
+
+void bus_init(bus *b);
+
+// Add the session `s` to the bus `b`. Units on a bus share the device:
+// they are detached and attached together. Returns zero if the bus is
+// full.
+int bus_join(bus *b, session *s);
+
+// Queue a read of `var_id`. Returns zero if the queue is full.
+int session_submit(session *s, int var_id, request_priority priority);
+
+// Number of requests queued in the given class.
+int session_queued(session const *s, request_priority priority);
+
+// Nonzero if a read of `var_id` is queued in the given class or in flight.
+int session_contains(session const *s, int var_id,
+                     request_priority priority);
+
+// Nonzero if nothing is queued or in flight.
+int session_idle(session const *s);
+
+// Milliseconds until `session_service` needs to be called again, when
+// the device has not become readable; -1 if there is nothing to do.
+int session_wakeup(session const *s);
+
+// Read what the device has sent, end the exchange in flight if it is
+// complete or timed out, and start the next one when pacing allows.
+void session_service(session *s);
+
+// Close the device, e.g., after it has been unplugged, ending the
+// exchange in flight without a response.
+void session_detach(session *s);
+
+// Continue the session using a newly opened device.
+void session_attach(session *s, int fd);
+
+// Service the session until it is idle, after reading the RTC of the
+// meter if that is due.
+void session_drain(session *s);
+
+#endif
@@ -0,0 +1,150 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "optical_eye_utils.h"
+#include "output.h"
+#include "sink.h"
+#include "trace.h"
+
+#define SINK_IDLE_NANOSECONDS 1000000
+#define SINK_TEXT_BUFFER_LENGTH 65536
+#define SINK_STORE_BUFFER_RECORDS 1024
+#define SINK_TEXT_PUSH_LENGTH (RING_MAX_PARTS * RING_RECORD_LENGTH)
+
+static ring sink_ring;
+static pthread_t sink_thread;
+static int sink_store_fd = -1;
+static int sink_started = 0;
+static atomic_int sink_stopping;
+static int sink_max_depth = 0;     // Only written by the sink thread.
+
+static char text_buffer[SINK_TEXT_BUFFER_LENGTH];
+static int text_length = 0;
+static store_record store_buffer[SINK_STORE_BUFFER_RECORDS];
+static int store_count = 0;
+
+static void write_text(void)
+{
+    int written = 0;
+    int64_t start = TRACE_NOW();
+    if (text_length == 0) return;
+    while (written < text_length) {
+        int result = write(1, text_buffer + written, text_length - written);
+        if (result <= 0) break;
+        written += result;
+    }
+    text_length = 0;
+    TRACE_SPAN("sink text", TRACE_THREAD_TRACK, NULL, 0, start);
+}
+
+static void write_store(void)
+{
+    int64_t start = TRACE_NOW();
+    if (store_count == 0) return;
+    if (!store_append(sink_store_fd, store_buffer, store_count)) {
+        perror("Could not write to the store");
+    }
+    store_count = 0;
+    TRACE_SPAN("sink store", TRACE_THREAD_TRACK, NULL, 0, start);
+}
+
+static void take_record(ring_record const *record, void *unused)
+{
+    if (record->destination == SINK_TEXT) {
+        if (text_length + record->length > SINK_TEXT_BUFFER_LENGTH) {
+            write_text();
+        }
+        memcpy(text_buffer + text_length, record->data, record->length);
+        text_length += record->length;
+    } else {
+        if (store_count == SINK_STORE_BUFFER_RECORDS) write_store();
+        memcpy(store_buffer + store_count++, record->data,
+               sizeof(store_record));
+    }
+}
+
+// Take the records in the ring, writing in big chunks, and sleep a
+// little when it is empty. Records may be pushed between finding the
+// ring empty and seeing that the sink is stopping, so the ring is
+// drained once more before the final write.
+static void *sink_loop(void *unused)
+{
+    while (1) {
+        struct timespec pause = {0, SINK_IDLE_NANOSECONDS};
+        int depth = ring_depth(&sink_ring);
+        if (depth > sink_max_depth) sink_max_depth = depth;
+        if (ring_pop(&sink_ring, take_record, NULL)) continue;
+        if (atomic_load(&sink_stopping)) {
+            while (ring_pop(&sink_ring, take_record, NULL)) {
+            }
+            write_text();
+            write_store();
+            return NULL;
+        }
+        write_text();
+        write_store();
+        nanosleep(&pause, NULL);
+    }
+}
+
+// Drain the ring at exit, including the output still buffered.
+static void sink_stop(void)
+{
+    output_flush();
+    atomic_store(&sink_stopping, 1);
+    pthread_join(sink_thread, NULL);
+}
+
+void sink_start(ring_policy policy, int store_fd)
+{
+    ring_init(&sink_ring, policy);
+    sink_store_fd = store_fd;
+    atomic_init(&sink_stopping, 0);
+    if (pthread_create(&sink_thread, NULL, sink_loop, NULL)) {
+        fail("Could not start the sink thread");
+    }
+    sink_started = 1;
+    atexit(sink_stop);
+    output_redirect(sink_text);
+}
+
+void sink_text(void const *text, int length, int sample)
+{
+    char const *next = text;
+    while (length > 0) {
+        int chunk = length < SINK_TEXT_PUSH_LENGTH ?
+            length : SINK_TEXT_PUSH_LENGTH;
+        ring_push(&sink_ring, SINK_TEXT, sample, next, chunk);
+        next += chunk;
+        length -= chunk;
+    }
+}
+
+void sink_store(store_record const *record, int sample)
+{
+    if (sink_store_fd < 0) return;
+    ring_push(&sink_ring, SINK_STORE, sample, record, sizeof(*record));
+}
+
+int sink_storing(void)
+{
+    return sink_store_fd >= 0;
+}
+
+void sink_get_statistics(sink_statistics *statistics)
+{
+    statistics->depth = sink_started ? ring_depth(&sink_ring) : 0;
+    statistics->max_depth = sink_max_depth;
+    statistics->capacity = RING_LENGTH;
+    statistics->pushed = atomic_load(&sink_ring.pushed);
+    statistics->dropped = atomic_load(&sink_ring.dropped);
+    statistics->dropped_samples = atomic_load(&sink_ring.dropped_samples);
+    statistics->waits = atomic_load(&sink_ring.waits);
+}
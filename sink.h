@@ -0,0 +1,46 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#ifndef SINK_H
+#define SINK_H
+
+#include "ring.h"
+#include "store.h"
+
+// The sinks of the values read: text on stdout and records in a store.
+// They are fed through a ring, and written by a thread of their own, so
+// a slow disk or reader of stdout never delays an exchange with a meter
+// unless the ring policy is RING_BLOCK and the ring is full.
+
+#define SINK_TEXT 0
+#define SINK_STORE 1
+
+// Start the sink thread, with a ring using `policy`, and route the
+// buffered output (see output.h) through it. `store_fd` is a store
+// opened by `store_open`, or -1 for none. The ring is drained at exit,
+// so other threads pushing output must be stopped before `exit`.
+void sink_start(ring_policy policy, int store_fd);
+
+// Queue text as one push of the ring, so it is never interleaved with
+// the text of other threads, nor partly dropped. Text longer than
+// RING_MAX_PARTS records, more than a flush of the output buffer in
+// either profile, takes several pushes. Has the signature of an output
+// hook, see `output_redirect`.
+void sink_text(void const *text, int length, int sample);
+
+// Queue a record for the store, if there is one.
+void sink_store(store_record const *record, int sample);
+
+// Nonzero if records are being stored.
+int sink_storing(void);
+
+// The counters of the ring.
+typedef struct _sink_statistics {
+    int depth, max_depth, capacity;
+    unsigned long pushed, dropped, dropped_samples, waits;
+} sink_statistics;
+
+void sink_get_statistics(sink_statistics *statistics);
+
+#endif
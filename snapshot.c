@@ -0,0 +1,223 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "config.h"
+#include "frames.h"
+#include "optical_eye_utils.h"
+#include "output.h"
+#include "pacing.h"
+#include "variables.h"
+
+// Read a group of registers as close together in time as possible: the
+// registers are requested in frames of up to BATCH_MAX_REGISTERS, sent
+// back to back, and each value is stamped with the middle of the
+// exchange which returned it. The spread of the snapshot is the time
+// from the first request to the last response, which bounds the skew
+// between any two of its values.
+
+#define DEFAULT_BAUDRATE B9600
+
+#define MAX_VAR_IDS 64
+#define MAX_FRAMES ((MAX_VAR_IDS + BATCH_MAX_REGISTERS - 1) / \
+                    BATCH_MAX_REGISTERS)
+
+typedef struct _snapshot_frame {
+    unsigned short var_ids[BATCH_MAX_REGISTERS];
+    int count;
+    unsigned char bytes[BATCH_FRAME_LENGTH];
+    int length;
+} snapshot_frame;
+
+static snapshot_frame frames[MAX_FRAMES];
+static int frame_count = 0;
+
+void usage(char *self) {
+    printf("Usage: %s (group|var_id|partial_var_name)[,...] "
+           "[device [baudrate [interval]]]\n", self);
+    printf("Groups:");
+    batch_frame const *batch;
+    for (batch = batch_frames; batch->name; batch++) {
+        printf(" %s", batch->name);
+    }
+    printf("\n");
+    exit(0);
+}
+
+// Group the registers into frames, using the prebuilt frame of a group
+// when it fills a frame by itself.
+static void build_frames(unsigned short const *var_ids, int count)
+{
+    int first;
+    for (first = 0; first < count; first += BATCH_MAX_REGISTERS) {
+        snapshot_frame *frame = frames + frame_count++;
+        unsigned char request[BATCH_REQUEST_LENGTH(BATCH_MAX_REGISTERS)];
+        unsigned char escaped[2 * sizeof(request)];
+        batch_frame const *batch;
+        frame->count = count - first < BATCH_MAX_REGISTERS ?
+            count - first : BATCH_MAX_REGISTERS;
+        memcpy(frame->var_ids, var_ids + first,
+               frame->count * sizeof(*var_ids));
+        for (batch = batch_frames; batch->name; batch++) {
+            if (batch->count == frame->count &&
+                !memcmp(batch->var_ids, frame->var_ids,
+                        frame->count * sizeof(*var_ids))) {
+                break;
+            }
+        }
+        if (batch->name) {
+            frame->length = batch->length;
+            memcpy(frame->bytes, batch->bytes, batch->length);
+        } else {
+            int length = build_batch_request(request, KMP_DEFAULT_ADDRESS,
+                                             frame->var_ids, frame->count);
+            frame->length = escape_package(request, length, escaped);
+            memcpy(frame->bytes, escaped, frame->length);
+        }
+    }
+}
+
+static void show_time(struct timespec const *time)
+{
+    struct tm local;
+    localtime_r(&time->tv_sec, &local);
+    output_format("%02d:%02d:%02d.%03ld ", local.tm_hour, local.tm_min,
+                  local.tm_sec, time->tv_nsec / 1000000);
+}
+
+// Show the registers in the response `buffer` to `frame`, stamped with
+// `stamp`. Registers missing from the response are reported as such.
+static void show_frame(register_cache *cache, snapshot_frame const *frame,
+                       unsigned char *buffer, int length,
+                       struct timespec const *stamp)
+{
+    unsigned char package[BATCH_BUFFER_LENGTH];
+    int index, offset = 0, package_length = 0;
+    for (index = 0; index < frame->count; index++) {
+        int var_id = frame->var_ids[index];
+        if (package_length >= 0) {
+            package_length = batch_entry(buffer, length, &offset, package);
+        }
+        show_time(stamp);
+        output_format("%s (id %i): ", var_name_of_id(var_id), var_id);
+        if (package_length > 0) {
+            show_package(cache, package, package_length, var_id);
+        } else if (package_length == 0) {
+            output_string("No value returned.\n");
+        } else {
+            output_string("Malformed response.\n");
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    char *device = DEVICE;
+    int baudrate = DEFAULT_BAUDRATE;
+    unsigned short var_ids[MAX_VAR_IDS];
+    int var_id_count = 0;
+    int interval = 0;  // Seconds between snapshots, 0: take one.
+    static unsigned char buffer[MAX_FRAMES][BATCH_BUFFER_LENGTH];
+    static register_cache registers;
+    char *var_arg;
+    pacing p;
+
+    if (argc < 2 || argc > 5) usage(argv[0]);
+    for (var_arg = strtok(argv[1], ",");
+         var_arg;
+         var_arg = strtok(NULL, ",")) {
+        batch_frame const *batch = batch_frame_of(var_arg);
+        if (batch) {
+            if (var_id_count + batch->count > MAX_VAR_IDS) usage(argv[0]);
+            memcpy(var_ids + var_id_count, batch->var_ids,
+                   batch->count * sizeof(*var_ids));
+            var_id_count += batch->count;
+            continue;
+        }
+        int var_id = atoi(var_arg);
+        if (var_id == 0) {
+            var_id = var_id_of_partial_name(var_arg);
+            if (var_id == 0) usage(argv[0]);
+        }
+        if (var_id_count == MAX_VAR_IDS) usage(argv[0]);
+        var_ids[var_id_count++] = var_id;
+    }
+    if (var_id_count == 0) usage(argv[0]);
+    if (argc > 2) {
+        device = argv[2];
+        printf("%s: Using device %s\n", argv[0], device);
+    }
+    if (argc > 3) {
+        baudrate = baudrate_of(argv[0], argv[3]);
+        printf("%s: Using baudrate %s\n", argv[0], argv[3]);
+    }
+    if (argc > 4) {
+        interval = atoi(argv[4]);
+        if (interval <= 0) usage(argv[0]);
+    }
+    build_frames(var_ids, var_id_count);
+
+    int optical_eye_fd = open_optical_eye(argv[0], device, baudrate, IS_8N2);
+    if (LOW_LATENCY) optical_eye_low_latency(argv[0], optical_eye_fd, device);
+    pacing_init(&p);
+    register_cache_init(&registers, KMP_DEFAULT_ADDRESS);
+    do {
+        struct timespec first, sent[MAX_FRAMES], received[MAX_FRAMES];
+        int lengths[MAX_FRAMES];
+        int index, spread;
+        pacing_wait(&p);
+        clock_gettime(CLOCK_MONOTONIC, &first);
+        // The exchanges go back to back, and the responses are decoded
+        // and shown afterwards, keeping the spread down.
+        for (index = 0; index < frame_count; index++) {
+            unsigned char *response = buffer[index];
+            clock_gettime(CLOCK_REALTIME, sent + index);
+            write(optical_eye_fd, frames[index].bytes, frames[index].length);
+            lengths[index] =
+                optical_eye_read_package(optical_eye_fd, response,
+                                         BATCH_BUFFER_LENGTH,
+                                         pacing_timeout(&p));
+            clock_gettime(CLOCK_REALTIME, received + index);
+        }
+        spread = milliseconds_since(&first);
+        for (index = 0; index < frame_count; index++) {
+            unsigned char *response = buffer[index];
+            int length = lengths[index];
+            int64_t exchange =
+                (int64_t)(received[index].tv_sec - sent[index].tv_sec) *
+                1000000000LL + received[index].tv_nsec - sent[index].tv_nsec;
+            int64_t middle = sent[index].tv_nsec + exchange / 2;
+            struct timespec stamp = sent[index];
+            stamp.tv_sec += middle / 1000000000LL;
+            stamp.tv_nsec = middle % 1000000000LL;
+            if (length == 0 || response[length - 1] != '\r') {
+                pacing_failure(&p);
+                show_time(&stamp);
+                output_format("No response to frame %d.\n", index + 1);
+                continue;
+            }
+            length = descape_package(response, length);
+            if (length < 6 || crc16(response + 1, length - 4) !=
+                ((response[length - 3] << 8) | response[length - 2])) {
+                pacing_failure(&p);
+                show_time(&stamp);
+                output_format("Corrupted response to frame %d.\n",
+                              index + 1);
+                continue;
+            }
+            pacing_success(&p, exchange / 1000000);
+            show_frame(&registers, frames + index, response, length, &stamp);
+        }
+        output_format("Spread: %d ms for %d registers in %d frames\n",
+                      spread, var_id_count, frame_count);
+        output_flush();
+        if (interval > 0) sleep(interval);
+    } while (interval > 0);
+    return 0;
+}
@@ -0,0 +1,140 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "state.h"
+
+#define STATE_FILE_LENGTH(devices) \
+    (sizeof(state_file) + (devices) * sizeof(state_device))
+
+static int valid_header(state_file const *file)
+{
+    return !memcmp(file->magic, STATE_MAGIC, sizeof(file->magic)) &&
+        file->version == STATE_VERSION &&
+        file->device_length == sizeof(state_device) &&
+        file->register_count == REGISTER_CACHE_SIZE;
+}
+
+state_file *state_open(char const *path, int device_count)
+{
+    state_file header, *file;
+    struct stat status;
+    int fd = open(path, O_RDWR | O_CREAT, 0644), fresh = 1, saved_errno;
+    if (fd < 0) return NULL;
+    if (fstat(fd, &status) < 0) goto failed;
+    if (status.st_size > 0) {
+        if (status.st_size < sizeof(header) ||
+            read(fd, &header, sizeof(header)) != sizeof(header) ||
+            memcmp(header.magic, STATE_MAGIC, sizeof(header.magic))) {
+            // Not a state file, maybe a mistyped path: leave it alone.
+            errno = EINVAL;
+            goto failed;
+        }
+        if (valid_header(&header) &&
+            status.st_size == STATE_FILE_LENGTH(header.device_count)) {
+            fresh = 0;
+            if (header.device_count > device_count) {
+                device_count = header.device_count;
+            }
+        } else {
+            // The state of another version or build, which is of no
+            // use, so it is replaced by a new file.
+            close(fd);
+            if (unlink(path) < 0) return NULL;
+            fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0644);
+            if (fd < 0) return NULL;
+        }
+    }
+    // Entries are only ever added, so existing ones keep their place.
+    if (ftruncate(fd, STATE_FILE_LENGTH(device_count)) < 0) goto failed;
+    file = mmap(NULL, STATE_FILE_LENGTH(device_count),
+                PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (file == MAP_FAILED) goto failed;
+    close(fd);
+    if (fresh) {
+        memcpy(file->magic, STATE_MAGIC, sizeof(file->magic));
+        file->version = STATE_VERSION;
+        file->device_length = sizeof(state_device);
+        file->register_count = REGISTER_CACHE_SIZE;
+    }
+    file->device_count = device_count;
+    return file;
+failed:
+    saved_errno = errno;
+    close(fd);
+    errno = saved_errno;
+    return NULL;
+}
+
+state_device *state_device_of(state_file *file, char const *path)
+{
+    state_device *unused = NULL;
+    int index;
+    if (strlen(path) >= STATE_PATH_LENGTH) return NULL;
+    for (index = 0; index < file->device_count; index++) {
+        state_device *device = file->devices + index;
+        if (!strcmp(device->path, path)) return device;
+        if (!device->path[0] && !unused) unused = device;
+    }
+    if (unused) {
+        memset(unused, 0, sizeof(*unused));
+        strcpy(unused->path, path);
+    }
+    return unused;
+}
+
+int state_restore(state_device const *saved, session *s)
+{
+    int index, restored = 0;
+    if (saved->sample_count >= 0 && saved->sample_count <= PACING_SAMPLES &&
+        saved->next_sample >= 0 && saved->next_sample < PACING_SAMPLES &&
+        saved->gap >= PACING_MIN_GAP && saved->gap <= PACING_MAX_GAP) {
+        for (index = 0; index < saved->sample_count; index++) {
+            s->pacing.samples[index] = saved->samples[index];
+        }
+        s->pacing.sample_count = saved->sample_count;
+        s->pacing.next_sample = saved->next_sample;
+        s->pacing.gap = saved->gap;
+    }
+    for (index = 0; index < REGISTER_CACHE_SIZE; index++) {
+        state_register const *entry = saved->registers + index;
+        if (entry->var_id &&
+            restore_metadata(&s->registers, entry->prefix, entry->length,
+                             entry->var_id)) {
+            restored++;
+        }
+    }
+    return restored;
+}
+
+void state_save_pacing(state_device *saved, session const *s)
+{
+    memcpy(saved->samples, s->pacing.samples, sizeof(saved->samples));
+    saved->sample_count = s->pacing.sample_count;
+    saved->next_sample = s->pacing.next_sample;
+    saved->gap = s->pacing.gap;
+}
+
+void state_save_register(state_device *saved, register_cache *cache,
+                         int var_id)
+{
+    register_metadata const *metadata = register_cache_find(cache, var_id);
+    state_register *entry;
+    if (!metadata) return;
+    entry = saved->registers + (metadata - cache->entries);
+    if (entry->var_id == var_id && entry->length == metadata->length &&
+        !memcmp(entry->prefix, metadata->prefix, sizeof(entry->prefix))) {
+        return;
+    }
+    // Invalidate the entry while it is being rewritten.
+    entry->var_id = 0;
+    entry->length = metadata->length;
+    memcpy(entry->prefix, metadata->prefix, sizeof(entry->prefix));
+    entry->var_id = var_id;
+}
@@ -0,0 +1,75 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#ifndef STATE_H
+#define STATE_H
+
+#include <stdint.h>
+#include "session.h"
+
+// The state file keeps what a session has learned about each meter, so
+// a restarted collector can poll at full speed at once: the baudrate
+// which worked, the observed turnaround times and the pacing gap, the
+// metadata of the registers seen, and where the sweep had come to.
+//
+// The file is mapped shared and updated in place as the state changes,
+// so it survives a crash of the process without any explicit saving.
+// A file with another layout, e.g., from a build with another register
+// cache size, is reset. Each restored register is validated as if its
+// response had just been received, so a torn update is just dropped.
+
+#define STATE_MAGIC "KMPSTATE"
+#define STATE_VERSION 1
+#define STATE_PATH_LENGTH 256
+
+typedef struct _state_register {
+    uint16_t var_id;               // 0: unused.
+    uint16_t length;               // Of the descaped package.
+    unsigned char prefix[6];       // Start token, address, type, id, unit.
+} state_register;
+
+typedef struct _state_device {
+    char path[STATE_PATH_LENGTH];  // Empty: unused.
+    int32_t baudrate;              // 0: no exchange has succeeded yet.
+    int32_t gap;
+    int32_t samples[PACING_SAMPLES];
+    int32_t sample_count;
+    int32_t next_sample;
+    int32_t sweep_index;
+    // Indexed like the entries of the register cache.
+    state_register registers[REGISTER_CACHE_SIZE];
+} state_device;
+
+typedef struct _state_file {
+    char magic[8];
+    uint32_t version;
+    uint32_t device_length;        // sizeof(state_device).
+    uint32_t register_count;       // REGISTER_CACHE_SIZE.
+    uint32_t device_count;
+    state_device devices[];
+} state_file;
+
+// Map the state file at `path`, with room for `device_count` devices,
+// creating it if it does not exist or is empty, and replacing a state
+// file of another version or build. Returns NULL with errno set if it
+// cannot be mapped, EINVAL if the file is something else, which is left
+// untouched.
+state_file *state_open(char const *path, int device_count);
+
+// The state of the device at `path`, taking an unused entry if it has
+// none. Returns NULL if all entries are taken.
+state_device *state_device_of(state_file *file, char const *path);
+
+// Restore the pacing and register metadata of `s` from `saved`, and
+// return the number of registers restored.
+int state_restore(state_device const *saved, session *s);
+
+// Save the pacing of `s`, after an exchange has ended.
+void state_save_pacing(state_device *saved, session const *s);
+
+// Save the metadata of `var_id`, if it is cached and has changed.
+void state_save_register(state_device *saved, register_cache *cache,
+                         int var_id);
+
+#endif
@@ -0,0 +1,201 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "store.h"
+
+uint32_t store_source(char const *name)
+{
+    // FNV-1a.
+    uint32_t hash = 2166136261u;
+    while (*name) hash = (hash ^ (unsigned char)*name++) * 16777619u;
+    return hash;
+}
+
+static int write_all(int fd, void const *buffer, int length)
+{
+    char const *next = buffer;
+    while (length > 0) {
+        int written = write(fd, next, length);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return 0;
+        next += written;
+        length -= written;
+    }
+    return 1;
+}
+
+int store_open(char const *path)
+{
+    store_header header;
+    int fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+    int length;
+    if (fd < 0) return -1;
+    length = read(fd, &header, sizeof(header));
+    if (length == 0) {
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, STORE_MAGIC, sizeof(header.magic));
+        header.version = STORE_VERSION;
+        header.record_length = sizeof(store_record);
+        if (write_all(fd, &header, sizeof(header))) return fd;
+    } else if (length == sizeof(header) &&
+               !memcmp(header.magic, STORE_MAGIC, sizeof(header.magic)) &&
+               header.version == STORE_VERSION &&
+               header.record_length == sizeof(store_record)) {
+        return fd;
+    } else {
+        errno = EINVAL;
+    }
+    close(fd);
+    return -1;
+}
+
+int store_append(int fd, store_record const *records, int count)
+{
+    return write_all(fd, records, count * sizeof(*records));
+}
+
+store_record const *store_map(char const *path, size_t *count)
+{
+    store_header const *header;
+    struct stat status;
+    int fd = open(path, O_RDONLY), saved_errno;
+    if (fd < 0) return NULL;
+    if (fstat(fd, &status) < 0) goto failed;
+    if (status.st_size < sizeof(*header)) {
+        errno = EINVAL;
+        goto failed;
+    }
+    header = mmap(NULL, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (header == MAP_FAILED) goto failed;
+    close(fd);
+    if (memcmp(header->magic, STORE_MAGIC, sizeof(header->magic)) ||
+        header->version != STORE_VERSION ||
+        header->record_length != sizeof(store_record)) {
+        munmap((void *)header, status.st_size);
+        errno = EINVAL;
+        return NULL;
+    }
+    madvise((void *)header, status.st_size, MADV_SEQUENTIAL);
+    *count = (status.st_size - sizeof(*header)) / sizeof(store_record);
+    return (store_record const *)(header + 1);
+failed:
+    saved_errno = errno;
+    close(fd);
+    errno = saved_errno;
+    return NULL;
+}
+
+int store_scan_digits(char const *text, int count)
+{
+    int value = 0;
+    while (count-- > 0) {
+        if (*text < '0' || *text > '9') return -1;
+        value = 10 * value + (*text++ - '0');
+    }
+    return value;
+}
+
+int store_parse_time(char const *text, int length, int64_t *time)
+{
+    struct tm tm;
+    time_t seconds;
+    if (length != 8 && (length != 13 || text[8] != '-')) return 0;
+    memset(&tm, 0, sizeof(tm));
+    tm.tm_year = store_scan_digits(text, 4) - 1900;
+    tm.tm_mon = store_scan_digits(text + 4, 2) - 1;
+    tm.tm_mday = store_scan_digits(text + 6, 2);
+    if (length == 13) {
+        tm.tm_hour = store_scan_digits(text + 9, 2);
+        tm.tm_min = store_scan_digits(text + 11, 2);
+    }
+    tm.tm_isdst = -1;
+    if (tm.tm_year < 0 || tm.tm_mon < 0 || tm.tm_mday < 0 ||
+        tm.tm_hour < 0 || tm.tm_min < 0) {
+        return 0;
+    }
+    seconds = mktime(&tm);
+    if (seconds == -1) return 0;
+    *time = seconds * STORE_SECOND;
+    return 1;
+}
+
+#define QUARTER 900
+
+int store_buckets_init(store_buckets *b, char const *period)
+{
+    int slot;
+    b->period = STORE_ALL;
+    b->length = 0;
+    for (slot = 0; slot < STORE_BUCKET_CACHE_LENGTH; slot++) {
+        b->quarters[slot] = -1;
+        b->dates[slot] = -1;
+    }
+    if (!period) return 1;
+    if (!strcmp(period, "day")) {
+        b->period = STORE_DAY;
+    } else if (!strcmp(period, "month")) {
+        b->period = STORE_MONTH;
+    } else {
+        b->period = STORE_SECONDS;
+        b->length = strcmp(period, "hour") ? atoi(period) : 3600;
+        if (b->length <= 0) return 0;
+        b->length *= STORE_SECOND;
+    }
+    return 1;
+}
+
+int64_t store_bucket_of(store_buckets *b, int64_t time)
+{
+    struct tm tm;
+    time_t seconds;
+    int64_t quarter;
+    int slot, date, date_slot;
+    if (b->period == STORE_ALL) return INT64_MIN;
+    if (b->period == STORE_SECONDS) {
+        return time - ((time % b->length) + b->length) % b->length;
+    }
+    seconds = time / STORE_SECOND;
+    quarter = seconds / QUARTER;
+    slot = quarter & (STORE_BUCKET_CACHE_LENGTH - 1);
+    if (b->quarters[slot] == quarter) return b->quarter_starts[slot];
+    localtime_r(&seconds, &tm);
+    date = b->period == STORE_MONTH ? 12 * tm.tm_year + tm.tm_mon :
+        366 * tm.tm_year + tm.tm_yday;
+    date_slot = date & (STORE_BUCKET_CACHE_LENGTH - 1);
+    if (b->dates[date_slot] != date) {
+        tm.tm_sec = tm.tm_min = tm.tm_hour = 0;
+        if (b->period == STORE_MONTH) tm.tm_mday = 1;
+        tm.tm_isdst = -1;
+        b->dates[date_slot] = date;
+        b->date_starts[date_slot] = mktime(&tm) * STORE_SECOND;
+    }
+    b->quarters[slot] = quarter;
+    b->quarter_starts[slot] = b->date_starts[date_slot];
+    return b->quarter_starts[slot];
+}
+
+int64_t store_bucket_end(store_buckets const *b, int64_t start)
+{
+    struct tm tm;
+    time_t seconds = start / STORE_SECOND;
+    if (b->period == STORE_ALL) return INT64_MAX;
+    if (b->period == STORE_SECONDS) return start + b->length;
+    localtime_r(&seconds, &tm);
+    tm.tm_sec = tm.tm_min = tm.tm_hour = 0;
+    if (b->period == STORE_MONTH) {
+        tm.tm_mon++;
+    } else {
+        tm.tm_mday++;
+    }
+    tm.tm_isdst = -1;
+    return mktime(&tm) * STORE_SECOND;
+}
@@ -0,0 +1,112 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#ifndef STORE_H
+#define STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The store is a file of fixed size binary records, one per value,
+// following a header. Records are only ever appended, in the order
+// they were produced, so a reader can map the file and scan it.
+
+#define STORE_MAGIC "KMPSTORE"
+#define STORE_VERSION 2
+
+typedef struct _store_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_length;
+} store_header;
+
+typedef enum _store_kind {
+    STORE_SAMPLE,                  // A value read from the meter.
+    STORE_MIN, STORE_MAX, STORE_MEAN, STORE_LAST // Of a rollup window.
+} store_kind;
+
+typedef struct _store_record {
+    int64_t time;                  // Nanoseconds since the epoch.
+    double value;
+    uint32_t source;               // See `store_source`.
+    uint32_t window;               // Seconds, 0 for samples.
+    uint32_t count;                // Samples in the window, 1 for samples.
+    // The time of the meter is `time` plus `meter_offset`, within
+    // `meter_error`, see meterclock.h.
+    int32_t meter_offset;          // Milliseconds.
+    int32_t meter_error;           // Milliseconds, -1: unknown.
+    uint16_t var_id;
+    uint8_t kind;                  // A store_kind.
+    uint8_t unit;                  // Unit code from the meter.
+} store_record;
+
+// The source of a record is a hash of the name of the device or file
+// the value came from.
+uint32_t store_source(char const *name);
+
+// Open the store at `path` for appending, creating it if it does not
+// exist. Returns the file descriptor, or -1 with errno set; a file
+// which is not a store of this version fails with EINVAL.
+int store_open(char const *path);
+
+// Append `count` records. Returns zero if they could not be written.
+int store_append(int fd, store_record const *records, int count);
+
+// Map the records of the store at `path` for reading, and set `count`.
+// A partial record at the end, from a write cut short, is left out.
+// Returns NULL with errno set, EINVAL if the file is not a store of
+// this version.
+store_record const *store_map(char const *path, size_t *count);
+
+// The times of records, and of the tools reading and writing stores, are
+// in nanoseconds since the epoch.
+#define STORE_SECOND 1000000000LL
+
+// The value of the `count` decimal digits at `text`, or -1 if they are
+// not all digits. The caller checks that they are there.
+int store_scan_digits(char const *text, int count);
+
+// Set `time` to the local time given by the `length` characters at
+// `text`, as YYYYMMDD or YYYYMMDD-HHMM like in the names of the logs of
+// readallvars. Returns zero if they are not such a time.
+int store_parse_time(char const *text, int length, int64_t *time);
+
+// Records are grouped by time into buckets: all in one, a number of
+// seconds aligned to the epoch, or local days or months. Finding the
+// day or month of a time takes `localtime_r` and `mktime`, which are
+// slow, so the start of the bucket of each quarter of an hour seen, and
+// of each day or month, is cached, direct mapped. Every time zone is a
+// whole number of quarters from UTC, so the time in a quarter is all in
+// one bucket.
+#ifndef STORE_BUCKET_CACHE_LENGTH
+#define STORE_BUCKET_CACHE_LENGTH 4096 // Must be a power of two.
+#endif
+
+typedef enum _store_period {
+    STORE_ALL, STORE_SECONDS, STORE_DAY, STORE_MONTH
+} store_period;
+
+typedef struct _store_buckets {
+    store_period period;
+    int64_t length;                // Of the buckets of seconds.
+    int64_t quarters[STORE_BUCKET_CACHE_LENGTH];
+    int64_t quarter_starts[STORE_BUCKET_CACHE_LENGTH];
+    int dates[STORE_BUCKET_CACHE_LENGTH];
+    int64_t date_starts[STORE_BUCKET_CACHE_LENGTH];
+} store_buckets;
+
+// Set up `b` for buckets given as "day", "month", "hour" or a number of
+// seconds, or one bucket for all time if `period` is NULL. Returns zero
+// if `period` is none of these.
+int store_buckets_init(store_buckets *b, char const *period);
+
+// The start of the bucket of `time`, INT64_MIN for the bucket of all
+// time.
+int64_t store_bucket_of(store_buckets *b, int64_t time);
+
+// The start of the bucket following the one starting at `start`,
+// INT64_MAX after the bucket of all time.
+int64_t store_bucket_end(store_buckets const *b, int64_t start);
+
+#endif
@@ -0,0 +1,171 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include "trace.h"
+
+#define TRACE_MAX_DEVICES 256      // Device tracks in the output.
+
+typedef struct _trace_event {
+    int64_t start, end;            // Nanoseconds.
+    char const *name;
+    char const *device;            // Must outlive the process, or NULL.
+    int var_id;
+    int track;
+} trace_event;
+
+typedef struct _trace_buffer {
+    atomic_int count;              // Events recorded.
+    int dropped;
+    trace_event events[TRACE_EVENTS];
+} trace_buffer;
+
+int trace_enabled = 0;
+static char const *trace_path;
+static trace_buffer *buffers;
+static atomic_int buffer_count;
+static atomic_ulong unbuffered;    // Spans of threads with no buffer.
+static __thread trace_buffer *own;
+static __thread int own_claimed;
+
+int64_t trace_clock(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+void trace_span(char const *name, int track, char const *device,
+                int var_id, int64_t start, int64_t end)
+{
+    trace_event *event;
+    int count;
+    if (!own_claimed) {
+        int index = atomic_fetch_add(&buffer_count, 1);
+        own = index < TRACE_THREADS ? buffers + index : NULL;
+        own_claimed = 1;
+    }
+    if (!own) {
+        atomic_fetch_add(&unbuffered, 1);
+        return;
+    }
+    count = atomic_load_explicit(&own->count, memory_order_relaxed);
+    if (count == TRACE_EVENTS) {
+        own->dropped++;
+        return;
+    }
+    event = own->events + count;
+    event->start = start;
+    event->end = end;
+    event->name = name;
+    event->device = device;
+    event->var_id = var_id;
+    event->track = track;
+    // The exporter only reads events below the published count.
+    atomic_store_explicit(&own->count, count + 1, memory_order_release);
+}
+
+static void write_string(FILE *out, char const *text)
+{
+    fputc('"', out);
+    for (; *text; text++) {
+        if (*text == '"' || *text == '\\') fputc('\\', out);
+        fputc(*text, out);
+    }
+    fputc('"', out);
+}
+
+// The track of `device`, adding it to `devices` if it is new.
+static int device_track(char const **devices, int *device_count,
+                        char const *device)
+{
+    int index;
+    for (index = 0; index < *device_count; index++) {
+        if (devices[index] == device || !strcmp(devices[index], device)) {
+            return index;
+        }
+    }
+    if (*device_count == TRACE_MAX_DEVICES) return TRACE_MAX_DEVICES;
+    devices[*device_count] = device;
+    return (*device_count)++;
+}
+
+static void trace_write(void)
+{
+    static char const *devices[TRACE_MAX_DEVICES];
+    int device_count = 0, buffer, threads, index, first = 1;
+    unsigned long dropped = atomic_load(&unbuffered);
+    FILE *out = fopen(trace_path, "w");
+    if (!out) {
+        perror("Could not write the trace");
+        return;
+    }
+    trace_enabled = 0;
+    threads = atomic_load(&buffer_count);
+    if (threads > TRACE_THREADS) threads = TRACE_THREADS;
+    fprintf(out, "{\"traceEvents\":[\n");
+    for (buffer = 0; buffer < threads; buffer++) {
+        trace_buffer *b = buffers + buffer;
+        int count = atomic_load_explicit(&b->count, memory_order_acquire);
+        dropped += b->dropped;
+        fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":2,"
+                "\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+                first ? "" : ",\n", buffer, buffer);
+        first = 0;
+        for (index = 0; index < count; index++) {
+            trace_event const *e = b->events + index;
+            int device = TRACE_THREAD_TRACK;
+            int on_device = e->track == TRACE_DEVICE_TRACK && e->device;
+            if (on_device) {
+                device = device_track(devices, &device_count, e->device);
+            }
+            fprintf(out, ",\n{\"name\":");
+            write_string(out, e->name);
+            fprintf(out, ",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,"
+                    "\"ts\":%.3f,\"dur\":%.3f,\"args\":{",
+                    on_device ? 1 : 2, on_device ? device : buffer,
+                    e->start / 1000.0, (e->end - e->start) / 1000.0);
+            if (e->device) {
+                fprintf(out, "\"device\":");
+                write_string(out, e->device);
+            }
+            if (e->var_id) {
+                fprintf(out, "%s\"var_id\":%d", e->device ? "," : "",
+                        e->var_id);
+            }
+            fprintf(out, "}}");
+        }
+    }
+    for (index = 0; index < device_count; index++) {
+        fprintf(out, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                "\"tid\":%d,\"args\":{\"name\":", index);
+        write_string(out, devices[index]);
+        fprintf(out, "}}");
+    }
+    fprintf(out, ",\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+            "\"args\":{\"name\":\"devices\"}},\n"
+            "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":2,"
+            "\"args\":{\"name\":\"threads\"}}\n"
+            "],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped\":%lu}}\n",
+            dropped);
+    fclose(out);
+}
+
+int trace_start(char const *path)
+{
+    buffers = mmap(NULL, TRACE_THREADS * sizeof(trace_buffer),
+                   PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffers == MAP_FAILED) return 0;
+    trace_path = path;
+    atomic_init(&buffer_count, 0);
+    atomic_init(&unbuffered, 0);
+    trace_enabled = 1;
+    atexit(trace_write);
+    return 1;
+}
@@ -0,0 +1,59 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+// Optional tracing of the stages of the exchanges, as spans with
+// CLOCK_MONOTONIC timestamps, written at exit as Chrome trace-event
+// JSON, which can be loaded into chrome://tracing or Perfetto.
+//
+// Each thread records into a buffer of its own, so recording takes no
+// locks, and a full buffer drops further spans. The buffers are only
+// mapped when tracing is started. When it is not, every trace point is
+// a test of `trace_enabled`.
+//
+// Spans of a device, e.g., "request write", "echo skip", "response
+// bytes" and "parse", are shown on a track per device; spans with no
+// device, or which may overlap the exchanges of their device, e.g.,
+// "decode" and "sink", on a track per thread.
+
+#ifndef TRACE_THREADS
+#define TRACE_THREADS 32
+#endif
+#ifndef TRACE_EVENTS
+#define TRACE_EVENTS 16384         // Per thread.
+#endif
+
+#define TRACE_DEVICE_TRACK 0
+#define TRACE_THREAD_TRACK 1
+
+extern int trace_enabled;
+
+// Start tracing, writing the trace to `path` at exit. Returns zero if
+// the buffers cannot be mapped.
+int trace_start(char const *path);
+
+// The current time in nanoseconds.
+int64_t trace_clock(void);
+
+// Record a span of `device`, which must stay valid, or NULL. `var_id`
+// is that of the exchange, or 0.
+void trace_span(char const *name, int track, char const *device,
+                int var_id, int64_t start, int64_t end);
+
+// A timestamp to start a span, or 0 when not tracing.
+#define TRACE_NOW() (trace_enabled ? trace_clock() : 0)
+
+// Record the span from `start` until now.
+#define TRACE_SPAN(name, track, device, var_id, start)                    \
+    do {                                                                  \
+        if (trace_enabled) {                                              \
+            trace_span(name, track, device, var_id, start, trace_clock()); \
+        }                                                                 \
+    } while (0)
+
+#endif
@@ -0,0 +1,912 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "optical_eye_utils.h"
+#include "output.h"
+#include "variables.h"
+
+#define unknown_variable_description "Meter response seen, variable unknown"
+
+// Units, provided by Erik Jensen. Unit 51 was empty, I made the guess that
+// it is used for variable length integer values, for things that can be
+// counted.
+
+static char* units[] = {
+    "Unit0",                                          // 0 (Was empty).
+    "Wh",       "kWh",      "MWh",      "GWh",        // 1-4 Power.
+    "j",        "kj",       "Mj",       "Gj",         // 5-8 Energy.
+    "Cal",      "kCal",     "Mcal",     "Gcal",       // 9-12 Heat energy.
+    "varh",     "kvarh",    "Mvarh",    "Gvarh",      // 13-16 Reactive energy.
+    "VAh",      "kVAh",     "MVAh",     "GVAh",       // 17-20 Energy.
+    "kW",       "kW",       "MW",       "GW",         // 21-24 Power.
+    "kvar",     "kvar",     "Mvar",     "Gvar",       // 25-28 Reactive power.
+    "VA",       "kVA",      "MVA",      "GVA",        // 29-32 Power.
+    "V",        "A",        "kV",       "kA",         // 33-36 Voltage/Current.
+    "C",        "K",                                  // 37-38 Temperature.
+    "l",        "m3",                                 // 39-40 Volume.
+    "l/h",      "m3/h",                               // 41-42 Flow of volume.
+    "m3xC",                                           // 43 ?
+    "ton",                                            // 44 Mass.
+    "ton/h",                                          // 45 Flow of mass.
+    "h",                                              // 46 Time.
+    "hh,mm,ss", "yy,mm,dd", "yyyy,mm,dd", "mm,dd",    // 47-50 Composite time.
+    "int?",                                           // 51 Counts?
+    "bar",                                            // 52 Pressure.
+    "RTC",                                            // 53 Composite time.
+    "ASCII",                                          // 54 Textual data.
+    "m3 x 10", "ton x 10", "GJ x 10",                 // 55-57 "10x units".
+    "minutes",                                        // 58 Time.
+    "Bitfield",                                       // 59 Binary data.
+    "s",        "ms",       "days",                   // 60-62 Time.
+    "RTC-Q",    "Datetime"                            // 63-64 Composite time.
+};
+static int units_length = 65;
+
+static UNIT_REPRESENTATION unit_representation[] = {
+    UR_UNKNOWN,                                       // 0
+    UR_FLOAT,   UR_FLOAT,   UR_FLOAT,   UR_FLOAT,     // 1-4 Power.
+    UR_FLOAT,   UR_FLOAT,   UR_FLOAT,   UR_FLOAT,     // 5-8 Energy.
+    UR_FLOAT,   UR_FLOAT,   UR_FLOAT,   UR_FLOAT,     // 9-12 Heat energy.
+    UR_FLOAT,   UR_FLOAT,   UR_FLOAT,   UR_FLOAT,     // 13-16 Reactive energy.
+    UR_FLOAT,   UR_FLOAT,   UR_FLOAT,   UR_FLOAT,     // 17-20 Energy.
+    UR_FLOAT,   UR_FLOAT,   UR_FLOAT,   UR_FLOAT,     // 21-24 Power.
+    UR_FLOAT,   UR_FLOAT,   UR_FLOAT,   UR_FLOAT,     // 25-28 Reactive power.
+    UR_FLOAT,   UR_FLOAT,   UR_FLOAT,   UR_FLOAT,     // 29-32 Power.
+    UR_FLOAT,   UR_FLOAT,   UR_FLOAT,   UR_FLOAT,     // 33-36 Voltage/Current.
+    UR_FLOAT,   UR_FLOAT,                             // 37-38 Temperature.
+    UR_FLOAT,   UR_FLOAT,                             // 39-40 Volume.
+    UR_FLOAT,   UR_FLOAT,                             // 41-42 Flow of volume.
+    UR_FLOAT,                                         // 43 ?
+    UR_FLOAT,                                         // 44 Mass.
+    UR_FLOAT,                                         // 45 Flow of mass.
+    UR_BYTE,                                          // 46 Time.
+    UR_TIME,    UR_DATE3,   UR_DATE4,   UR_DATE2,     // 47-50 Composite time.
+    UR_VARINT,                                        // 51 Counts?
+    UR_FLOAT,                                         // 52 Pressure.
+    UR_RTC,                                           // 53 Composite time.
+    UR_ASCII,                                         // 54 Textual data.
+    UR_FLOAT,   UR_FLOAT,   UR_FLOAT,                 // 55-57 "10x units".
+    UR_BYTE,                                          // 58 Time.
+    UR_BITS,                                          // 59 Binary data.
+    UR_BYTE,    UR_INT,     UR_INT,                   // 60-62 Time.
+    UR_RTCQ,    UR_DATETIME                           // 63-64 Composite time.
+};
+
+// Variable identifiers and descriptions, provided by Kim Djernaes.
+// A number of extra variable names found in various online sources.
+
+id2str var_data[] = {
+    {   0, "Load profile logger"},
+    {   1, "Active energy A14"},
+    {   2, "Active energy A23"},
+    {   3, "Reactive energy R12"},
+    {   4, "Reactive energy R34"},
+    {   5, "Reactive energy R1"},
+    {   6, "Reactive energy R4"},
+    {   7, "Secondary active energy A14"},
+    {   8, "Secondary active energy A23"},
+    {   9, "Secondary reactive energy R12"},
+    {  10, "Secondary reactive energy R34"},
+    {  11, "Secondary reactive energy R1"},
+    {  12, "Secondary reactive energy R4"},
+    {  13, "Active energy A14, verification"},
+    {  14, "Active energy A23, verification"},
+    {  15, "Reactive energy R12, verification"},
+    {  16, "Reactive energy R34, verification"},
+    {  17, "Resettable counter A14"},
+    {  18, "Resettable counter A23"},
+    {  19, "Active energy A14 Tariff 1"},
+    {  20, "Active energy A23 Tariff 1"},
+    {  21, "Reactive energy R12 Tariff 1"},
+    {  22, "Reactive energy R34 Tariff 1"},
+    {  23, "Active energy A14 Tariff 2"},
+    {  24, "Active energy A23 Tariff 2"},
+    {  25, "Reactive energy R12 Tariff 2"},
+    {  26, "Reactive energy R34 Tariff 2"},
+    {  27, "Active energy A14 Tariff 3"},
+    {  28, "Active energy A23 Tariff 3"},
+    {  29, "Reactive energy R12 Tariff 3"},
+    {  30, "Reactive energy R34 Tariff 3"},
+    {  31, "Active energy A14 Tariff 4"},
+    {  32, "Active energy A23 Tariff 4"},
+    {  33, "Reactive energy R12 Tariff 4"},
+    {  34, "Reactive energy R34 Tariff 4"},
+    {  35, "Average power P+"},
+    {  36, "Average power P-"},
+    {  37, "Average power Q1Q2"},
+    {  38, "Average power Q3O4"},
+    {  39, "Max power P14"},
+    {  40, "Max power P23"},
+    {  41, "Max power Q12"},
+    {  42, "Max power Q34"},
+    {  43, "Accumulated max power P14"},
+    {  44, "Accumulated max power P23"},
+    {  45, "Accumulated max power Q12"},
+    {  46, "Accumulated max power Q34"},
+    {  47, "Number of debiting periods"},
+    {  48, "Transformer ratio (x/5A)"},
+    {  50, "Meter status"},
+    {  51, "Meter number 1"},
+    {  52, "Meter number 2"},
+    {  53, "Meter number 3"},
+    {  54, "Configurations number 1"},
+    {  55, "Configurations number 2"},
+    {  56, "Configurations number 3"},
+    {  57, "Special Data 1"},
+    {  58, "Pulse input"},
+    { 199, "Load profile logger interval"},
+    { 222, "ConfigChangedEventCount"},
+    { 231, "IncrementConfigChangeEventCount"},
+    {1001, "Serial number"},
+    {1002, "Clock"},
+    {1003, "Date"},
+    {1004, "Hour counter"},
+    {1005, "Software revision"},
+    {1010, "Total meter number"},
+    {1021, "Special Data 2"},
+    {1023, "Actual power P14"},
+    {1024, "Actual power P23"},
+    {1025, "Actual power Q12"},
+    {1026, "Actual power Q34"},
+    {1027, "Time stamp active max power, P+max"},
+    {1028, "Date active max power, P+max"},
+    {1029, "Configurations number 4"},
+    {1030, "Internal number"},
+    {1031, "Active energy A1234"},
+    {1032, "Operation mode"},
+    {1033, "Max power P14 Tariff 1"},
+    {1034, "Max power P14 Tariff 1 clock"},
+    {1035, "Max power P14 Tariff 1 date"},
+    {1036, "Max power P14 Tariff 2"},
+    {1037, "Max power P14 Tariff 2 clock"},
+    {1038, "Max power P14 Tariff 2 date"},
+    {1039, "Power threshold value"},
+    {1040, "Power threshold counter"},
+    {1043, "Clock 2"},
+    {1044, "Date 2"},
+    {1045, "RTC status"}, // Meter responds as unknown.
+    {1046, "VCOCCO status"},
+    {1047, "RTC"},
+    {1048, "RTC 2"},
+    {1049, "Max power P14 RTC"},
+    {1050, "Max power P14 Tariff 1 RTC"},
+    {1051, "Max power P14 Tariff 2 RTC"},
+    {1054, "Voltage L1"},
+    {1055, "Voltage L2"},
+    {1056, "Voltage L3"},
+    {1058, "Type number"},
+    {1059, "Active energy A14 Tariff 5"},
+    {1060, "Active energy A14 Tariff 6"},
+    {1061, "Active energy A14 Tariff 7"},
+    {1062, "Active energy A14 Tariff 8"},
+    {1063, "Active energy A23 Tariff 5"},
+    {1064, "Active energy A23 Tariff 6"},
+    {1065, "Active energy A23 Tariff 7"},
+    {1066, "Active energy A23 Tariff 8"},
+    {1067, "Reactive energy R12 Tariff 5"},
+    {1068, "Reactive energy R12 Tariff 6"},
+    {1069, "Reactive energy R12 Tariff 7"},
+    {1070, "Reactive energy R12 Tariff 8"},
+    {1071, "Reactive energy R34 Tariff 5"},
+    {1072, "Reactive energy R34 Tariff 6"},
+    {1073, "Reactive energy R34 Tariff 7"},
+    {1074, "Reactive energy R34 Tariff 8"},
+    {1075, "Configurations number 5"},
+    {1076, "Current L1"},
+    {1077, "Current L2"},
+    {1078, "Current L3"},
+    {1079, "Internal meter temperature"},
+    {1080, "Actual power P14 L1"},
+    {1081, "Actual power P14 L2"},
+    {1082, "Actual power P14 L3"},
+    {1083, "ROM checksum"},
+    {1084, "Voltage extremity"}, // Meter responds as unknown.
+    {1085, "Voltage event"}, // Meter responds as unknown.
+    {1086, "Logger status"},
+    {1087, "Connection status"},
+    {1088, "Connection feedback"},
+    {1089, "EPU state L1"},
+    {1090, "EPU state L2"},
+    {1091, "EPU state L3"},
+    {1092, "EPU reset counter"},
+    {1101, "Module port UART setup"},
+    {1102, "Module port I/O configuration"},
+    {1108, unknown_variable_description},
+    {1109, unknown_variable_description},
+    {1110, unknown_variable_description},
+    {1111, unknown_variable_description},
+    {1112, unknown_variable_description},
+    {1113, unknown_variable_description},
+    {1114, unknown_variable_description},
+    {1115, unknown_variable_description},
+    {1116, unknown_variable_description},
+    {1117, "Switching on"},
+    {1118, unknown_variable_description},
+    {1119, unknown_variable_description},
+    {1120, unknown_variable_description},
+    {1121, unknown_variable_description},
+    {1122, unknown_variable_description},
+    {1123, "OBISBitmap"},
+    {1124, "PushButton Control"},
+    {1125, "PushButton Status"},
+    {1126, "Unified typenumber"},
+    {1127, "Max power Q12 RTC"},
+    {1128, "Max power Q12 time"},
+    {1129, "Max power Q12 date"},
+    {1130, "Max power Q12 Tariff 1"},
+    {1131, "Max power Q12 Tariff 1 RTC"},
+    {1132, "Max power Q12 Tariff 1 time"},
+    {1133, "Max power Q12 Tariff 1 date"},
+    {1134, "Max power Q12 Tariff 2"},
+    {1135, "Max power Q12 Tariff 2 RTC"},
+    {1136, "Max power Q12 Tariff 2 time"},
+    {1137, "Max power Q12 Tariff 2 date"},
+    {1138, "Secondary active energy A14 Tariff 1"},
+    {1139, "Secondary active energy A14 Tariff 2"},
+    {1140, "Secondary active energy A14 Tariff 3"},
+    {1141, "Secondary active energy A14 Tariff 4"},
+    {1142, "Secondary active energy A14 Tariff 5"},
+    {1143, "Secondary active energy A14 Tariff 6"},
+    {1144, "Secondary active energy A14 Tariff 7"},
+    {1145, "Secondary active energy A14 Tariff 8"},
+    {1146, "Secondary active energy A23 Tariff 1"},
+    {1147, "Secondary active energy A23 Tariff 2"},
+    {1148, "Secondary active energy A23 Tariff 3"},
+    {1149, "Secondary active energy A23 Tariff 4"},
+    {1150, "Secondary active energy A23 Tariff 5"},
+    {1151, "Secondary active energy A23 Tariff 6"},
+    {1152, "Secondary active energy A23 Tariff 7"},
+    {1153, "Secondary active energy A23 Tariff 8"},
+    {1154, "Secondary reactive energy R12 Tariff 1"},
+    {1155, "Secondary reactive energy R12 Tariff 2"},
+    {1156, "Secondary reactive energy R12 Tariff 3"},
+    {1157, "Secondary reactive energy R12 Tariff 4"},
+    {1158, "Secondary reactive energy R12 Tariff 5"},
+    {1159, "Secondary reactive energy R12 Tariff 6"},
+    {1160, "Secondary reactive energy R12 Tariff 7"},
+    {1161, "Secondary reactive energy R12 Tariff 8"},
+    {1162, "Secondary reactive energy R34 Tariff 1"},
+    {1163, "Secondary reactive energy R34 Tariff 2"},
+    {1164, "Secondary reactive energy R34 Tariff 3"},
+    {1165, "Secondary reactive energy R34 Tariff 4"},
+    {1166, "Secondary reactive energy R34 Tariff 5"},
+    {1167, "Secondary reactive energy R34 Tariff 6"},
+    {1168, "Secondary reactive energy R34 Tariff 7"},
+    {1169, "Secondary reactive energy R34 Tariff 8"},
+    {1170, "Power factor L1"},
+    {1171, "Power factor L2"},
+    {1172, "Power factor L3"},
+    {1173, "Total power factor"},
+    {1174, "Transformer ratio before"},
+    {1175, "Debit 2 loggerinterval"},
+    {1179, "Transformer ratio lock"},
+    {1180, unknown_variable_description},
+    {1181, "Production time"},
+    {1182, unknown_variable_description},
+    {1183, unknown_variable_description},
+    {1184, unknown_variable_description},
+    {1185, unknown_variable_description},
+    {1187, "LCD resolution for power and current"},
+    {1188, "dCon status"},
+    {1189, "Config code OOO"},
+    {1190, "P14 maximum"},
+    {1191, "P14 minimum"},
+    {1192, "LegalLoggerSize"},
+    {1193, "LegalLoggerDepth"},
+    {1194, "AnalysisLoggerDepth"},
+    {1195, "AnalysisLoggerInterval"},
+    {1196, "P14maximumClock"},
+    {1197, "P14maximumDate"},
+    {1198, "P14maximumRTC"},
+    {1199, "P14minimumClock"},
+    {1200, "P14minimumDate"},
+    {1201, "P14minimumRTC"},
+    {1202, unknown_variable_description},
+    {1203, unknown_variable_description},
+    {1204, unknown_variable_description},
+    {1205, unknown_variable_description},
+    {1206, unknown_variable_description},
+    {1207, unknown_variable_description},
+    {1208, unknown_variable_description},
+    {1209, unknown_variable_description},
+    {1210, "LoadProfileRegisterSetup"},
+    {1211, "LoadProfileLoggerSetup"},
+    {1212, "VQLogUlow"},
+    {1213, "VQLogUhigh"},
+    {1214, "VQLogTeventMinDuration"},
+    {1215, "Average Voltage L1"},
+    {1216, "Average Voltage L2"},
+    {1217, "Average Voltage L3"},
+    {1218, "Average Current L1"},
+    {1219, "Average Current L2"},
+    {1220, "Average Current L3"},
+    {1221, "Software lock"},
+    {1222, "LoadProfileEventStatus"},
+    {1223, unknown_variable_description},
+    {1224, "LoggerStatus2"},
+    {1225, "RFsupply"},
+    {1226, "Load1Active"},
+    {1227, "Load1Mode"},
+    {1228, "Load1ConvertTariffToPos"},
+    {1229, "Load2Active"},
+    {1230, "Load2Mode"},
+    {1231, "Load2ConvertTariffToPos"},
+    {1232, "LoadVariableDelay"},
+    {1233, "WorkingdaysSetup"},
+    {1234, "PulseInputLevel"},
+    {1235, "EventStatusA"},
+    {1236, "EventMaskA"},
+    {1237, "EventStatusB"},
+    {1238, "EventMaskB_PosEdge"},
+    {1239, "EventMaskB_NegEdge"},
+    {1240, "DayLightSavingConfig"},
+    {1241, "DataQualityMask"},
+    {1242, "NeutralFaultLogEvent"},
+    {1243, "Module identity"},
+    {1244, "Load1VariableDelayCnt"},
+    {1245, "Load2VariableDelayCnt"},
+    {1246, "NeutralFault V_Neutral threshold"},
+    {1247, "NeutralFault V_Line threshold"},
+    {1248, "NeutralFault Time threshold"},
+    {1249, "Neutral Voltage"},
+    {1250, "DisplayTest"},
+    {1251, "DisplayUserForcedCall"},
+    {1252, "DisplayDisconnect"},
+    {1253, "DisplayDebitationLogger"},
+    {1254, "DisplayLoadProfileLogger"},
+    {1255, unknown_variable_description},
+    {1256, unknown_variable_description},
+    {1257, unknown_variable_description},
+    {1258, unknown_variable_description},
+    {1259, unknown_variable_description},
+    {1260, unknown_variable_description},
+    {1261, "Accumulated active energy A14 Day"},
+    {1262, "Accumulated active energy A14 Week"},
+    {1263, "Accumulated active energy A14 Month"},
+    {1264, "Accumulated active energy A14 Year"},
+    {1265, "Manual readout checksum"},
+    {1266, unknown_variable_description},
+    {1267, unknown_variable_description},
+    {1268, unknown_variable_description},
+    {1269, unknown_variable_description},
+    {1270, unknown_variable_description},
+    {1271, "KMP communication address"},
+    {1272, "DLMS address"},
+    {1536, "NeutralVoltageAvgL1"},
+    {1537, "NeutralVoltageAvgL2"},
+    {1538, "NeutralVoltageAvgL3"},
+    {2010, "Active tariff"},
+    {2011, "Tariff mode"},
+    {2018, unknown_variable_description},
+    {   0, NULL } // End marker.
+};
+
+char const *var_name_of_id(int var_id) {
+    char const *name = "Undefined";
+    id2str *p;
+    for (p = var_data; p->description; p++) {
+        if (p->id == var_id) name = p->description;
+    }
+    return name;
+}
+
+unsigned int var_id_of_partial_name(char const *partial_name) {
+    unsigned int var_id = 0;
+    id2str *p;
+    for (p = var_data; p->description; p++) {
+        if (strstr(p->description, partial_name) != NULL) var_id = p->id;
+    }
+    return var_id;
+}
+
+void show_package_hex(unsigned char const *buffer, int length) {
+    output_hex(buffer, length);
+}
+
+void show_package_ascii(unsigned char const *buffer, int length) {
+    int index;
+    for (index = 0; index < length; index++) {
+        output_char(buffer[index]);
+    }
+}
+
+void show_package_named_char(unsigned char const *buffer, int length) {
+    int index;
+    for (index = 0; index < length; index++) {
+        output_char(buffer[index]);
+        if (buffer[index] == '\r') output_string("\n");
+    }
+}
+
+// The response to a read of an unknown register holds no register:
+// start token, address, type, CRC and end token.
+static int empty_response(register_cache const *cache,
+                          unsigned char const *buffer, int length) {
+    return length == 6 && buffer[0] == '\x40' &&
+        buffer[1] == cache->address && buffer[2] == '\x10' &&
+        crc16((unsigned char *)buffer + 1, 2) ==
+        ((buffer[3] << 8) | buffer[4]);
+}
+
+double decode_float_value(unsigned char length,
+                          unsigned char *representation) {
+    int exponent = representation[0] & 0x3f;
+    if (representation[0] & 0x40) exponent = -exponent;
+
+    unsigned char const *mantissa_bytes = representation + 1;
+    unsigned long mantissa = 0;
+    int index;
+    for (index = 0; index < length; index++) {
+        mantissa <<= 8;
+        mantissa |= mantissa_bytes[index];
+    }
+    double factor = pow(10.0, (double)exponent);
+    double value = ((double)mantissa) * factor;
+    if (representation[0] & 0x80) value = -value;
+    return value;
+}
+
+void show_unsupported_value(char const *kind, unsigned char const *buffer,
+                            int const length, char const *unit) {
+    output_format("%s not yet supported, ", kind);
+    show_package_hex(buffer, length);
+    output_format(" [%s]\n", unit);
+}
+
+void show_time_value(unsigned char const *buffer, int const length,
+                     char const *unit) {
+    int hhmmss = 16777216 * buffer[2] + 65536 * buffer[3] +
+        256 * buffer[4] + buffer[5];
+    int ss = hhmmss % 100;
+    int hhmm = hhmmss / 100;
+    int mm = hhmm % 100;
+    int hh = hhmm / 100;
+    output_format("%02d:%02d:%02d [%s", hh, mm, ss, unit);
+    if (buffer[0] != 4 || buffer[1] != 0) {
+        output_format(", unexpected data length: %d]\n",
+                      buffer[0] + 256 * buffer[1]);
+    } else {
+        output_string("]\n");
+    }
+}
+
+char* const month_name[] = {
+    "(Undefined month: zero)",
+    "Jan", "Feb", "Mar", "Apr",
+    "May", "Jun", "Jul", "Aug",
+    "Sep", "Oct", "Nov", "Dec"
+};
+
+void show_date3_value(unsigned char const *buffer, int const length,
+                      char const *unit) {
+    int yymmdd = 16777216 * buffer[2] + 65536 * buffer[3] +
+        256 * buffer[4] + buffer[5];
+    int dd = yymmdd % 100;
+    int yymm = yymmdd / 100;
+    int mm = yymm % 100;
+    int yy = yymm / 100;
+    output_format("%02d-%s-%02d [%s", yy, month_name[mm], dd, unit);
+    if (buffer[0] != 4 || buffer[1] != 0) {
+        output_format(", unexpected data length: %d]\n",
+                      buffer[0] + 256 * buffer[1]);
+    } else {
+        output_string("]\n");
+    }
+}
+
+void show_rtc_value(unsigned char const *buffer, int const length,
+                    char const *unit) {
+    int unknown1 = buffer[2];
+    int unknown2 = buffer[3];
+    int second = buffer[4];
+    int minute = buffer[5];
+    int hour = buffer[6];
+    int date = buffer[7];
+    int month = buffer[8];
+    int year = buffer[9] + 2000;
+    output_format("%02d:%02d:%02d %02d-%s-%02d [%s, unknown part: %02x %02x",
+                  hour, minute, second, date, month_name[month], year,
+                  unit, unknown1, unknown2);
+    if (buffer[0] != 8 || buffer[1] != 0) {
+        output_format(", unexpected rtc data length: %d]\n",
+                      buffer[0] + 256 * buffer[1]);
+    } else {
+        output_string("]\n");
+    }
+}
+
+int package_rtc_time(unsigned char const *buffer, int length, int address,
+                     int var_id, time_t *time) {
+    // The data is laid out as shown by `show_rtc_value`.
+    unsigned char const *data = buffer + 6;
+    struct tm tm;
+    if (length != 19 || buffer[1] != address || buffer[2] != '\x10' ||
+        (buffer[3] << 8 | buffer[4]) != var_id || buffer[5] >= units_length ||
+        unit_representation[buffer[5]] != UR_RTC ||
+        data[0] != 8 || data[1] != 0 || data[8] < 1 || data[8] > 12) {
+        return 0;
+    }
+    memset(&tm, 0, sizeof(tm));
+    tm.tm_sec = data[4];
+    tm.tm_min = data[5];
+    tm.tm_hour = data[6];
+    tm.tm_mday = data[7];
+    tm.tm_mon = data[8] - 1;
+    tm.tm_year = data[9] + 100;
+    tm.tm_isdst = -1;
+    *time = mktime(&tm);
+    return *time != -1;
+}
+
+void show_ascii_value(unsigned char const *buffer, int const length,
+                      char const *unit) {
+    // Apparently, the length is encoded twice for ASCII data:
+    // One time in the general data format, and one more time in
+    // the data area itself. We use the former to decide on the
+    // amount of text shown, and print the latter, such that the
+    // user can see both (they seem to follow each other, but if
+    // they sometimes differ the user will at least get a hint).
+    int embedded_length = buffer[0] + 256 * buffer[1];
+    output_string("\"");
+    show_package_ascii(buffer + 2, length - 2);
+    output_format("\" [%s, length %d]\n", unit, embedded_length);
+}
+
+void show_varint_value(unsigned char const *buffer, int const length,
+                       char const *unit) {
+    // This is about unit 51 which is currently undocumented; guessing
+    // that it contains an variable length unsigned integer number in
+    // big-endian format which may be used for counting things, we show
+    // it in a decimal format. We use the embedded length to decide on
+    // the number of bytes to include, and give a hint in the case where
+    // the specified total buffer length differs.
+    int embedded_length = buffer[0] + 256 * buffer[1];
+    if (embedded_length > length - 2) {
+        // The value seems to occupy more bytes than the buffer contains.
+        // We cannot interpret data beyond the data area that we have
+        // received, so we drop out entirely here, and show the raw data.
+        show_unsupported_value("Malformed INT", buffer, length, unit);
+    } else {
+        int index;
+        unsigned long int value = 0;
+        for (index = 0; index < embedded_length; index++) {
+            value <<= 8;
+            value |= buffer[index + 2];
+        }
+        if (embedded_length == length - 2) {
+            // Data area used exactly, as expected.
+            output_format("%lu [%s, length %d]\n",
+                          value, unit, embedded_length);
+        } else {
+            // embedded_length < length - 2:
+            output_format("[%s, length %d]\n", unit, embedded_length);
+        }
+    }
+}
+
+void register_cache_init(register_cache *cache, int address) {
+    memset(cache, 0, sizeof(*cache));
+    cache->address = address;
+}
+
+// The probe is bounded, so a full cache cannot make a lookup loop: when
+// the entries probed are all taken by other registers, the home entry
+// is returned and a lookup misses.
+register_metadata *register_cache_slot(register_cache *cache,
+                                       unsigned int var_id) {
+    unsigned int home = var_id & (REGISTER_CACHE_SIZE - 1), probe;
+    for (probe = 0; probe < REGISTER_CACHE_PROBES; probe++) {
+        unsigned int index = (home + probe) & (REGISTER_CACHE_SIZE - 1);
+        if (!cache->entries[index].decoder ||
+            cache->entries[index].var_id == var_id) {
+            return cache->entries + index;
+        }
+    }
+    return cache->entries + home;
+}
+
+register_metadata const *register_cache_find(register_cache *cache,
+                                             unsigned int var_id) {
+    register_metadata const *metadata = register_cache_slot(cache, var_id);
+    return metadata->decoder && metadata->var_id == var_id ? metadata : NULL;
+}
+
+void decode_float_data(unsigned char const *data, int data_length,
+                       register_metadata const *metadata) {
+    double value = decode_float_value(data[0], (unsigned char *)data + 1);
+    if (metadata->length == 15) {
+        output_format("%0.4f %s\n", value, metadata->unit);
+    } else {
+        output_format("%0.3f %s\n", value, metadata->unit);
+    }
+}
+
+void decode_unsupported_data(unsigned char const *data, int data_length,
+                             register_metadata const *metadata) {
+    show_unsupported_value(metadata->kind, data, data_length, metadata->unit);
+}
+
+void decode_time_data(unsigned char const *data, int data_length,
+                      register_metadata const *metadata) {
+    show_time_value(data, data_length, metadata->unit);
+}
+
+void decode_date3_data(unsigned char const *data, int data_length,
+                       register_metadata const *metadata) {
+    show_date3_value(data, data_length, metadata->unit);
+}
+
+void decode_ascii_data(unsigned char const *data, int data_length,
+                       register_metadata const *metadata) {
+    show_ascii_value(data, data_length, metadata->unit);
+}
+
+void decode_rtc_data(unsigned char const *data, int data_length,
+                     register_metadata const *metadata) {
+    show_rtc_value(data, data_length, metadata->unit);
+}
+
+void decode_varint_data(unsigned char const *data, int data_length,
+                        register_metadata const *metadata) {
+    show_varint_value(data, data_length, metadata->unit);
+}
+
+void decode_raw_data(unsigned char const *data, int data_length,
+                     register_metadata const *metadata) {
+    output_string("Raw data:");
+    show_package_hex(data, data_length);
+    if (*metadata->unit) {
+        output_format(" [no unit: %d]\n", metadata->prefix[5]);
+    } else {
+        output_format(" [%s]\n", metadata->unit);
+    }
+}
+
+// Resolve the decoder to use for the given representation, or NULL if
+// a package of the given length cannot be decoded.
+value_decoder decoder_of(UNIT_REPRESENTATION representation, int length,
+                         char const **kind) {
+    *kind = NULL;
+    switch (representation) {
+        case UR_FLOAT:
+            return length == 15 || length == 13 ? decode_float_data : NULL;
+        case UR_INT:      *kind = "INT"; break;
+        case UR_BYTE:     *kind = "BYTE"; break;
+        case UR_TIME:     return decode_time_data;
+        case UR_DATE2:    *kind = "DATE2"; break;
+        case UR_DATE3:    return decode_date3_data;
+        case UR_DATE4:    *kind = "DATE4"; break;
+        case UR_ASCII:    return decode_ascii_data;
+        case UR_BITS:     *kind = "BITS"; break;
+        case UR_RTC:      return decode_rtc_data;
+        case UR_RTCQ:     *kind = "RTCQ"; break;
+        case UR_DATETIME: *kind = "DATETIME"; break;
+        case UR_VARINT:   return decode_varint_data;
+        case UR_UNKNOWN:  return decode_raw_data;
+        default:
+            perror("Bug please report: unexpected unit representation");
+            exit(-1);
+    }
+    return decode_unsupported_data;
+}
+
+// Validate the package against the cached metadata for `var_id`, and
+// return the metadata if it can be decoded directly, otherwise NULL.
+register_metadata const *cached_metadata(register_cache *cache,
+                                         unsigned char const *buffer,
+                                         int length, int var_id) {
+    register_metadata const *metadata = register_cache_find(cache, var_id);
+    if (!metadata || metadata->length != length ||
+        memcmp(buffer, metadata->prefix, sizeof(metadata->prefix))) {
+        return NULL;
+    }
+    return metadata;
+}
+
+// Record the metadata of a package which can be decoded by `decoder`.
+register_metadata const *cache_metadata(register_cache *cache,
+                                        unsigned char const *buffer,
+                                        int length, int var_id,
+                                        value_decoder decoder,
+                                        char const *kind) {
+    register_metadata *slot = register_cache_slot(cache, var_id);
+    slot->var_id = var_id;
+    memcpy(slot->prefix, buffer, sizeof(slot->prefix));
+    slot->length = length;
+    slot->representation = unit_representation[buffer[5]];
+    slot->kind = kind;
+    slot->unit = units[buffer[5]];
+    slot->decoder = decoder;
+    return slot;
+}
+
+int restore_metadata(register_cache *cache, unsigned char const *prefix,
+                     int length, int var_id) {
+    char const *kind;
+    value_decoder decoder;
+    if (length < 9 || length > RESPONSE_BUFFER_LENGTH ||
+        prefix[1] != cache->address || prefix[2] != '\x10' ||
+        (prefix[3] << 8 | prefix[4]) != var_id || prefix[5] >= units_length) {
+        return 0;
+    }
+    decoder = decoder_of(unit_representation[prefix[5]], length, &kind);
+    if (!decoder) return 0;
+    cache_metadata(cache, prefix, length, var_id, decoder, kind);
+    return 1;
+}
+
+int register_unit_code(register_cache *cache, int var_id) {
+    register_metadata const *metadata = register_cache_find(cache, var_id);
+    return metadata ? metadata->prefix[5] : -1;
+}
+
+char const *unit_name(int code) {
+    return code >= 0 && code < units_length ? units[code] : NULL;
+}
+
+int unit_code_of(char const *name, int length) {
+    int code;
+    for (code = 0; code < units_length; code++) {
+        if (!strncmp(units[code], name, length) && !units[code][length]) {
+            return code;
+        }
+    }
+    return -1;
+}
+
+char const *register_unit(register_cache *cache, int var_id) {
+    register_metadata const *metadata = register_cache_find(cache, var_id);
+    return metadata ? metadata->unit : NULL;
+}
+
+int check_crc(unsigned char const *buffer, int length) {
+    unsigned short crc_expected = crc16((unsigned char *)buffer + 1,
+                                        length - 4);
+    unsigned short crc_found = (buffer[length - 3] << 8) | buffer[length - 2];
+    if (crc_expected != crc_found) {
+        output_format("Warning: Wrong CRC, found 0x%04X, expected 0x%04X\n",
+                      crc_found, crc_expected);
+        return 0;
+    }
+    return 1;
+}
+
+int show_package(register_cache *cache, unsigned char *buffer, int length,
+                 int var_id) {
+    register_metadata const *metadata =
+        cached_metadata(cache, buffer, length, var_id);
+    if (metadata) {
+        int intact = check_crc(buffer, length);
+        metadata->decoder(buffer + 6, length - 9, metadata);
+        return intact;
+    }
+    if (empty_response(cache, buffer, length)) {
+        output_string("No value returned.\n");
+        return 1;
+    }
+    int intact = check_crc(buffer, length);
+    if (buffer[1] != cache->address) {
+        output_format("Unexpected meter unit address: found 0x%02X, "
+                      "expected 0x%02X\n", buffer[1], cache->address);
+        show_package_named_char(buffer, length);
+        return intact;
+    }
+    if (buffer[2] != '\x10') {
+        output_format("Unexpected type of response: found 0x%02X, "
+                      "expected 0x10\n", buffer[2]);
+        show_package_named_char(buffer, length);
+        return intact;
+    }
+    if ((buffer[3] << 8 | buffer[4]) != var_id) {
+        output_format("Unexpected variable id: found 0x%04X, "
+                      "expected 0x%04X\n", buffer[3] << 8 | buffer[4], var_id);
+        show_package_named_char(buffer, length);
+        return intact;
+    }
+    if (buffer[5] >= units_length) {
+        output_format("Unexpected unit: found 0x%02X, expected 0x00..0x%02X\n",
+                      buffer[5], units_length);
+        show_package_hex(buffer, length);
+        output_string("\n");
+        return intact;
+    }
+    char const *kind;
+    value_decoder decoder =
+        decoder_of(unit_representation[buffer[5]], length, &kind);
+    if (!decoder) {
+        show_package_hex(buffer, length);
+        output_string("\n");
+        return intact;
+    }
+    metadata = cache_metadata(cache, buffer, length, var_id, decoder, kind);
+    decoder(buffer + 6, length - 9, metadata);
+    return intact;
+}
+
+int package_value(register_cache *cache, unsigned char const *buffer,
+                  int length, int var_id, double *value) {
+    register_metadata const *metadata =
+        cached_metadata(cache, buffer, length, var_id);
+    if (!metadata) {
+        char const *kind;
+        value_decoder decoder;
+        if (length < 9 || buffer[1] != cache->address ||
+            buffer[2] != '\x10' ||
+            (buffer[3] << 8 | buffer[4]) != var_id ||
+            buffer[5] >= units_length) {
+            return 0;
+        }
+        decoder = decoder_of(unit_representation[buffer[5]], length, &kind);
+        if (!decoder) return 0;
+        metadata = cache_metadata(cache, buffer, length, var_id, decoder,
+                                  kind);
+    }
+    unsigned char const *data = buffer + 6;
+    int data_length = length - 9;
+    if (metadata->decoder == decode_float_data) {
+        *value = decode_float_value(data[0], (unsigned char *)data + 1);
+        return 1;
+    }
+    if (metadata->representation == UR_VARINT) {
+        int embedded_length = data[0] + 256 * data[1];
+        unsigned long int integer = 0;
+        int index;
+        if (embedded_length != data_length - 2) return 0;
+        for (index = 0; index < embedded_length; index++) {
+            integer <<= 8;
+            integer |= data[index + 2];
+        }
+        *value = (double)integer;
+        return 1;
+    }
+    return 0;
+}
+
+int build_batch_request(unsigned char *request, int address,
+                        unsigned short const *var_ids, int count) {
+    int index, length = 0;
+    request[length++] = '\x80';    // Start of request token.
+    request[length++] = (unsigned char)address; // Of receiver unit.
+    request[length++] = '\x10';    // Read variable command.
+    request[length++] = (unsigned char)count;
+    for (index = 0; index < count; index++) {
+        request[length++] = (unsigned char)(var_ids[index] >> 8);
+        request[length++] = (unsigned char)(var_ids[index] & 0xff);
+    }
+    unsigned short crc = crc16(request + 1, length - 1);
+    request[length++] = (unsigned char)(crc >> 8);
+    request[length++] = (unsigned char)(crc & 0xff);
+    request[length++] = '\x0d';    // End of request token.
+    return length;
+}
+
+int build_read_request(unsigned char *request, int address, int var_id) {
+    unsigned short id = (unsigned short)var_id;
+    return build_batch_request(request, address, &id, 1);
+}
+
+int batch_entry(unsigned char const *buffer, int length, int *offset,
+                unsigned char *package) {
+    // Each entry is the variable id, the unit, the length, the
+    // exponent and the value bytes, following the start token, the
+    // address and the type, and preceding the CRC and end token.
+    int end = length - 3, entry_length;
+    if (*offset < 3) *offset = 3;
+    if (*offset >= end) return 0;
+    if (*offset + 5 > end) return -1;
+    entry_length = 5 + buffer[*offset + 3];
+    if (*offset + entry_length > end) return -1;
+    memcpy(package, buffer, 3);
+    memcpy(package + 3, buffer + *offset, entry_length);
+    unsigned short crc = crc16(package + 1, entry_length + 2);
+    package[entry_length + 3] = (unsigned char)(crc >> 8);
+    package[entry_length + 4] = (unsigned char)(crc & 0xff);
+    package[entry_length + 5] = '\x0d';
+    *offset += entry_length;
+    return entry_length + 6;
+}
@@ -0,0 +1,166 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#ifndef VARIABLES_H
+#define VARIABLES_H
+
+#include <time.h>
+
+typedef struct _id2str {
+    unsigned int id;
+    char const *description;
+} id2str;
+
+// Known variables, terminated by an entry whose description is NULL.
+extern id2str var_data[];
+
+typedef enum _UNIT_REPRESENTATION {
+    UR_UNKNOWN, UR_INT, UR_FLOAT, UR_BYTE, UR_TIME,
+    UR_DATE2, UR_DATE3, UR_DATE4,
+    UR_ASCII, UR_BITS, UR_RTC, UR_RTCQ, UR_DATETIME,
+    UR_VARINT
+} UNIT_REPRESENTATION;
+
+// Decoders are given the data area of a response package, i.e., the
+// bytes following the unit byte and preceding the CRC, along with the
+// metadata of the register.
+
+struct _register_metadata;
+typedef void (*value_decoder)(unsigned char const *data, int data_length,
+                              struct _register_metadata const *metadata);
+
+// Metadata for a register, resolved from the first response which could
+// be decoded. The unit and representation of a given register never
+// changes for a given meter, so subsequent responses can be checked
+// against `prefix` and `length` and then go directly to `decoder`.
+typedef struct _register_metadata {
+    unsigned int var_id;
+    unsigned char prefix[6];       // Start token, address, type, id, unit.
+    int length;                    // Expected length of the package.
+    UNIT_REPRESENTATION representation;
+    char const *kind;              // Used when the value is not supported.
+    char const *unit;
+    value_decoder decoder;
+} register_metadata;
+
+// The address of a unit in a meter, as the destination of a request and
+// the source of the response. An optical eye reaches the unit at the
+// default address; units sharing a multi-drop line have their own.
+#define KMP_DEFAULT_ADDRESS 0x3f
+
+// The cache is kept per meter unit, so it is implicitly keyed by meter
+// type, and responses are only accepted from the address of the unit.
+// A register is looked for in at most REGISTER_CACHE_PROBES entries,
+// and when they are all taken by other registers, the first of them is
+// reused, so a cache smaller than the number of registers being read
+// only costs cache misses.
+#ifndef REGISTER_CACHE_SIZE
+#define REGISTER_CACHE_SIZE 512 // Must be a power of two.
+#endif
+#define REGISTER_CACHE_PROBES 8
+
+typedef struct _register_cache {
+    unsigned char address;
+    register_metadata entries[REGISTER_CACHE_SIZE];
+} register_cache;
+
+// Clear `cache`, for the unit at `address`.
+void register_cache_init(register_cache *cache, int address);
+
+char const *var_name_of_id(int var_id);
+
+unsigned int var_id_of_partial_name(char const *partial_name);
+
+void show_package_hex(unsigned char const *buffer, int length);
+
+void show_package_ascii(unsigned char const *buffer, int length);
+
+void show_package_named_char(unsigned char const *buffer, int length);
+
+double decode_float_value(unsigned char length,
+                          unsigned char *representation);
+
+// The entry of `cache` for `var_id`, which may be empty or hold another
+// register when the entries probed are all taken.
+register_metadata *register_cache_slot(register_cache *cache,
+                                       unsigned int var_id);
+
+// The metadata of `var_id` if it is in `cache`, otherwise NULL.
+register_metadata const *register_cache_find(register_cache *cache,
+                                             unsigned int var_id);
+
+// Show the value in the descaped response package `buffer`, using and
+// updating the register metadata in `cache`. Returns zero if the
+// package was corrupted, such that the exchange should be considered
+// failed.
+int show_package(register_cache *cache, unsigned char *buffer, int length,
+                 int var_id);
+
+// Find the numeric value in the descaped response package `buffer`,
+// without showing anything, for floating point and counter registers.
+// Returns zero if there is no such value. The metadata in `cache` is
+// used and updated as by `show_package`.
+int package_value(register_cache *cache, unsigned char const *buffer,
+                  int length, int var_id, double *value);
+
+// The unit of `var_id`, as seen in its first decodable response, or
+// NULL if none has been seen.
+char const *register_unit(register_cache *cache, int var_id);
+
+// Enter the metadata of `var_id` into `cache`, as if a package of
+// `length` bytes starting with `prefix` (the 6 bytes up to and
+// including the unit) had been decoded. Returns zero if such a package
+// is not valid or cannot be decoded.
+int restore_metadata(register_cache *cache, unsigned char const *prefix,
+                     int length, int var_id);
+
+// As `register_unit`, giving the unit code sent by the meter, or -1.
+int register_unit_code(register_cache *cache, int var_id);
+
+// The name of the unit with the code `code`, or NULL if it is unknown.
+char const *unit_name(int code);
+
+// The register holding the real time clock of the meter.
+#define RTC_VAR_ID 1047
+
+// The time shown by the RTC value in the package `buffer` of `length`
+// bytes, a response for `var_id` from the unit at `address`, in seconds
+// since the epoch, taking the clock of the meter to be in local time.
+// Returns zero if the package does not hold an RTC value.
+int package_rtc_time(unsigned char const *buffer, int length, int address,
+                     int var_id, time_t *time);
+
+// The names of the months, as shown in dates, indexed from 1.
+extern char* const month_name[];
+
+// The code of the unit named by the `length` characters at `name`, or
+// -1 if there is none. A few names have two codes, e.g., "kW", and the
+// first of them is given.
+int unit_code_of(char const *name, int length);
+
+#define READ_REQUEST_LENGTH 9
+
+// Build the (unescaped) request for reading `var_id` from the unit at
+// `address` into `request`, and return its length. Known registers have
+// a prebuilt wire frame for KMP_DEFAULT_ADDRESS, see frames.h.
+int build_read_request(unsigned char *request, int address, int var_id);
+
+#define BATCH_REQUEST_LENGTH(count) (7 + 2 * (count))
+
+// Build the (unescaped) request for reading the `count` registers in
+// `var_ids` from the unit at `address` into `request`, and return its
+// length.
+int build_batch_request(unsigned char *request, int address,
+                        unsigned short const *var_ids, int count);
+
+// Take the next register from the descaped response package `buffer`
+// to a batch request, starting from `*offset` which must be 0 for the
+// first one, and store it in `package` as the package a single read of
+// that register would have given. Returns the length of `package`, 0
+// when there are no more registers, and -1 if the response is
+// malformed. `package` must have room for `length` bytes.
+int batch_entry(unsigned char const *buffer, int length, int *offset,
+                unsigned char *package);
+
+#endif
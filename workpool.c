@@ -0,0 +1,131 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <unistd.h>
+#include "workpool.h"
+
+typedef struct _worker_start {
+    workpool *pool;
+    int index;
+    int cpu;
+} worker_start;
+
+static worker_start starts[WORKPOOL_MAX_WORKERS];
+
+void pin_to_cpu(int cpu)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    cpu_set_t set;
+    if (cpus <= 0) return;
+    CPU_ZERO(&set);
+    CPU_SET(cpu % cpus, &set);
+    // Pinning is an optimization, so a failure is ignored.
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+// Take a task from the bottom of the own deque, or else steal one from
+// the top of another deque. A task is known to be available.
+static void *take_task(workpool *pool, int index)
+{
+    int offset;
+    for (offset = 0; ; offset = (offset + 1) % pool->workers) {
+        work_deque *deque = pool->deques + (index + offset) % pool->workers;
+        void *task = NULL;
+        pthread_mutex_lock(&deque->lock);
+        if (deque->top != deque->bottom) {
+            if (offset == 0) {
+                deque->bottom--;
+                task = deque->tasks[deque->bottom % WORKPOOL_DEQUE_LENGTH];
+            } else {
+                task = deque->tasks[deque->top % WORKPOOL_DEQUE_LENGTH];
+                deque->top++;
+            }
+        }
+        pthread_mutex_unlock(&deque->lock);
+        if (task) {
+            if (offset > 0) pool->deques[index].stolen++;
+            pool->deques[index].executed++;
+            return task;
+        }
+    }
+}
+
+static void *worker(void *argument)
+{
+    worker_start *start = argument;
+    workpool *pool = start->pool;
+    pin_to_cpu(start->cpu);
+    while (1) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->pending == 0 && !pool->stopping) {
+            pthread_cond_wait(&pool->wakeup, &pool->lock);
+        }
+        if (pool->pending == 0) {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        pool->pending--;
+        pthread_mutex_unlock(&pool->lock);
+        pool->run(take_task(pool, start->index));
+    }
+}
+
+int workpool_start(workpool *pool, int workers, int first_cpu,
+                   work_function run)
+{
+    int index;
+    memset(pool, 0, sizeof(*pool));
+    if (workers < 1 || workers > WORKPOOL_MAX_WORKERS) return 0;
+    pool->run = run;
+    pool->workers = workers;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wakeup, NULL);
+    for (index = 0; index < workers; index++) {
+        pthread_mutex_init(&pool->deques[index].lock, NULL);
+    }
+    for (index = 0; index < workers; index++) {
+        starts[index].pool = pool;
+        starts[index].index = index;
+        starts[index].cpu = first_cpu + index;
+        if (pthread_create(pool->threads + index, NULL, worker,
+                           starts + index)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void workpool_stop(workpool *pool)
+{
+    int index;
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->wakeup);
+    pthread_mutex_unlock(&pool->lock);
+    for (index = 0; index < pool->workers; index++) {
+        pthread_join(pool->threads[index], NULL);
+    }
+}
+
+int workpool_submit(workpool *pool, int hint, void *task)
+{
+    work_deque *deque = pool->deques + hint % pool->workers;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom - deque->top == WORKPOOL_DEQUE_LENGTH) {
+        pthread_mutex_unlock(&deque->lock);
+        return 0;
+    }
+    deque->tasks[deque->bottom % WORKPOOL_DEQUE_LENGTH] = task;
+    deque->bottom++;
+    pthread_mutex_unlock(&deque->lock);
+    pthread_mutex_lock(&pool->lock);
+    pool->pending++;
+    pthread_cond_signal(&pool->wakeup);
+    pthread_mutex_unlock(&pool->lock);
+    return 1;
+}
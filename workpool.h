@@ -0,0 +1,62 @@
+// Copyright (c) 2015, Erik Ernst. All rights reserved. Use of this
+// source code is governed by a BSD-style license that can be found in
+// the LICENSE file.
+
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+#include <pthread.h>
+
+// A pool of worker threads with work stealing: each worker has its own
+// deque of tasks, submitters choose a deque, and a worker takes tasks
+// from the bottom of its own deque, or steals from the top of another
+// when its own is empty. The deques are fixed size, so the number of
+// tasks outstanding must be bounded by the user, e.g., by having at
+// most one task per device outstanding.
+
+#ifndef WORKPOOL_MAX_WORKERS
+#define WORKPOOL_MAX_WORKERS 16
+#endif
+#ifndef WORKPOOL_DEQUE_LENGTH
+#define WORKPOOL_DEQUE_LENGTH 256   // Must be a power of two.
+#endif
+
+typedef void (*work_function)(void *task);
+
+typedef struct _work_deque {
+    pthread_mutex_t lock;
+    void *tasks[WORKPOOL_DEQUE_LENGTH];
+    unsigned int top, bottom;      // Tasks are at top..bottom-1.
+    unsigned long executed;        // Tasks run by the owner.
+    unsigned long stolen;          // Tasks run by the owner, stolen.
+} work_deque;
+
+typedef struct _workpool {
+    work_function run;
+    int workers;
+    work_deque deques[WORKPOOL_MAX_WORKERS];
+    pthread_t threads[WORKPOOL_MAX_WORKERS];
+    pthread_mutex_t lock;          // Protects `pending`.
+    pthread_cond_t wakeup;
+    int pending;                   // Tasks submitted and not yet taken.
+    int stopping;
+} workpool;
+
+// Start `workers` threads running `run` on the submitted tasks, pinning
+// worker `index` to cpu `first_cpu + index` modulo the number of cpus.
+// Returns zero if the threads could not be started.
+int workpool_start(workpool *pool, int workers, int first_cpu,
+                   work_function run);
+
+// Submit `task` to the deque of worker `hint` modulo the number of
+// workers. Returns zero if that deque is full.
+int workpool_submit(workpool *pool, int hint, void *task);
+
+// Wait for the workers to run the tasks submitted, and stop them. No
+// tasks may be submitted meanwhile.
+void workpool_stop(workpool *pool);
+
+// Pin the calling thread to `cpu` modulo the number of cpus online.
+void pin_to_cpu(int cpu);
+
+#endif